@@ -0,0 +1,732 @@
+#include "app.hpp"
+
+#include <cmath>
+
+#include "profiler.hpp"
+#include "telemetry.hpp"
+#include "text_format.hpp"
+
+// --- Matching ---
+constexpr int32_t EARLY_ACCEPT = to_q15(0.9); //a pause scoring above this ends the capture early
+
+// bias as telemetry carries it, integers in 1/1000 count
+static int32_t millicounts(float counts)
+{
+    return (int32_t)lroundf(counts * 1000.0f);
+}
+
+// raw counts to hundredths of a dps, rounded like "%.2f" would
+static int32_t centi_dps(int16_t raw)
+{
+    int64_t scaled = (int64_t)raw * GyroConfig::SENSITIVITY_UDPS;
+    return (int32_t)((scaled + (scaled < 0 ? -5000 : 5000)) / 10000);
+}
+
+// --- Strip chart ---
+// laid over the readouts while a gesture is captured, when they say little
+constexpr Rect CHART_AREA = {0, 0, 240, 140};
+constexpr int32_t CHART_RANGE = GyroConfig::counts(245000); //the sensor's full range
+
+// --- Feedback ---
+constexpr int SUCCESS_FRAMES = 51; //25 green/black strobes, ending on green
+constexpr uint32_t SUCCESS_GREEN_MS = 80;
+constexpr uint32_t SUCCESS_BLACK_MS = 100;
+constexpr uint32_t FAILURE_MS = 1000; //how long the wrong gesture screen stays up
+
+// --- Touch targets ---
+// panel coordinates: the panel's y runs up from the bottom edge of the LCD
+enum TouchTarget
+{
+    TOUCH_UNLOCK,
+    TOUCH_RECORD
+};
+
+static const HitTarget TOUCH_TARGETS[] = {
+    {TOUCH_UNLOCK, {20, 10, 90, 40}}, //Unlock button
+    {TOUCH_RECORD, {130, 10, 90, 40}}, //Record button
+};
+
+App::App(Display &display, Touch &touch, Sampler &sampler, PowerManager &power, TemplateStore &store,
+         BiasStore &bias_store, EventLoop &events)
+    : lcd(display), ts(touch), sampler(sampler), power(power), template_store(store), bias_store(bias_store),
+      events(events), renderer(display), chart(display), touch_input(touch, events, TOUCH_TARGETS, sizeof(TOUCH_TARGETS) / sizeof(TOUCH_TARGETS[0]))
+{
+}
+
+App::State App::state() const
+{
+    return current;
+}
+
+App::Results App::results() const
+{
+    return counters;
+}
+
+GestureSpotter::Stats App::spotter_stats() const
+{
+    return spotter.stats();
+}
+
+void App::set_always_on(bool enabled)
+{
+    always_on = enabled;
+}
+
+void App::start()
+{
+    touch_input.set_contact_handler(on_contact, this);
+    touch_input.start(); //falls back to polling if the panel has no interrupt
+    power.set_wake_handler(on_wake, this);
+    last_activity_ms = hal_now_ms();
+    tick_event = events.call_every(TICK_MS, on_tick, this);
+}
+
+void App::on_tick(void *app)
+{
+    static_cast<App *>(app)->tick();
+}
+
+void App::on_animation_step(void *app)
+{
+    static_cast<App *>(app)->animation_step();
+}
+
+void App::on_contact(void *app)
+{
+    App &self = *static_cast<App *>(app);
+    self.last_activity_ms = hal_now_ms();
+    self.power.wake(WAKE_TOUCH); //the press itself is handled once the tick runs again
+}
+
+void App::on_wake(void *app)
+{
+    App &self = *static_cast<App *>(app);
+    self.last_activity_ms = hal_now_ms();
+    self.renderer.invalidate(); //the frame buffers were not kept while the display was off
+    self.renderer.render();
+    self.spotting = false; //the stream has a gap, the spotter starts over
+    self.tick_event = self.events.call_every(TICK_MS, on_tick, &self);
+}
+
+void App::tick()
+{
+    PROFILE_SCOPE(PROF_UI_TICK);
+
+    if (telemetry_take_command() == TELEMETRY_CMD_PROFILE)
+    {
+        PROFILE_REPORT();
+    }
+
+    // While idle in always-on mode the spotter follows the stream, from a
+    // clean start after every capture, feedback screen or doze
+    bool spot = always_on && current == IDLE && enrollment != NOT_ENROLLED;
+    if (spot && !spotting)
+    {
+        if (enrollment == ENROLLED_STORED)
+        {
+            load_templates();
+        }
+        filters.reset();
+        spotter.reset();
+    }
+    spotting = spot;
+
+    // consume everything the sampler queued since the last pass
+    GyroData sample;
+    GyroData block[FilterBank::BLOCK];
+    size_t pending = 0;
+    bool arrived = false, moved = false;
+    while (sampler.samples().pop(sample))
+    {
+        arrived = true;
+        moved = moved || PowerManager::moving(sample);
+        data = sample; //newest sample drives the display
+        if (current == RECORDING || current == UNLOCKING || spotting)
+        {
+            block[pending++] = sample; //every sample, the segmenter or spotter decides what belongs to a gesture
+            if (pending == FilterBank::BLOCK)
+            {
+                capture_block(block, pending);
+                pending = 0;
+            }
+        }
+    }
+    if (pending > 0)
+    {
+        capture_block(block, pending);
+    }
+    if (arrived)
+    {
+        power.samples_arrived(); //completes a wake
+    }
+    if (moved || current != IDLE)
+    {
+        last_activity_ms = hal_now_ms();
+    }
+
+    // For plotting, stream every sample with telemetry_set_streaming() and
+    // export it with tools/telemetry_decode --csv
+
+    // Display data on LCD
+    display_xyz(data);
+
+    // show how much of the gesture has been captured
+    if (segmenter.capturing())
+    {
+        display_count(segmenter.length());
+    }
+
+    // Handle touch input, once per press
+    TouchEvent touch;
+    while (touch_input.poll(touch))
+    {
+        handle_touch(touch);
+    }
+
+    // the sampler follows temperature drift while the board rests
+    uint32_t bias_updates = sampler.stats().bias_updates;
+    if (bias_updates != bias_updates_seen)
+    {
+        bias_updates_seen = bias_updates;
+        persist_bias();
+    }
+
+    // the feedback screens own the display until they finish
+    if (current != SHOWING_SUCCESS && current != SHOWING_FAILURE)
+    {
+        PROFILE_SCOPE(PROF_RENDER);
+        renderer.render(); //paint whatever changed this pass
+    }
+
+    if (current == IDLE && hal_now_ms() - last_activity_ms >= IDLE_TIMEOUT_MS)
+    {
+        doze();
+    }
+}
+
+void App::doze()
+{
+    telemetry_log(TM_DOZING, (int32_t)(hal_now_ms() - last_activity_ms));
+    events.cancel(tick_event);
+    tick_event = 0;
+    power.doze();
+}
+
+void App::begin_capture(State mode)
+{
+    if (mode == UNLOCKING && enrollment == NOT_ENROLLED)
+    {
+        update_status("Record a gesture first");
+        return;
+    }
+
+    // a new attempt cuts any feedback animation short
+    if (animation_event != 0)
+    {
+        events.cancel(animation_event);
+        animation_event = 0;
+    }
+    if (current == SHOWING_SUCCESS || current == SHOWING_FAILURE)
+    {
+        renderer.invalidate();
+    }
+
+    // first capture after boot: pull the enrolled gestures from storage
+    // while waiting for motion, so pauses can be scored against them
+    if (enrollment == ENROLLED_STORED)
+    {
+        load_templates();
+    }
+
+    current = mode;
+    sampler.samples().flush(); //start from fresh samples
+    filters.reset();
+    segmenter.reset();
+    paused_length = 0;
+    chart.begin(CHART_AREA, CHART_RANGE);
+    chart.show(true);
+    renderer.set_text(count_label, "");
+    update_status("Waiting for motion...");
+    clearButtons();
+    if (mode == RECORDING)
+    {
+        telemetry_log(TM_RECORDING);
+        renderer.set_color(record_fill, COLOR_RED); // change button color
+    }
+    else
+    {
+        telemetry_log(TM_UNLOCKING);
+        PROFILE_START(PROF_TOUCH_TO_VERDICT);
+        renderer.set_color(unlock_fill, COLOR_GREEN); // change button color
+    }
+}
+
+void App::finish_capture()
+{
+    print_sampler_stats();
+    chart.show(false); //the feedback screens are on the frame buffers beneath
+
+    // clear sample count
+    renderer.set_text(count_label, "");
+
+    // reset button color
+    clearButtons();
+
+    if (current == RECORDING)
+    {
+        // a new user, or the oldest one replaced once every slot is taken
+        int slot = template_store.next_slot();
+        enrollment = ENROLLED_LOADED;
+        counters.recordings++;
+        template_index.add(slot, recorded_array);
+        if (!spotter.add(slot, recorded_array))
+        {
+            telemetry_log(TM_SPOT_FULL, slot + 1);
+        }
+        if (!template_store.save(slot, recorded_array))
+        {
+            telemetry_log(TM_PERSIST_FAILED);
+        }
+        telemetry_log(TM_ENROLLED, slot + 1);
+
+        // display recording stored
+        char status[32];
+        format_int(format_text(status, "Stored as user "), slot + 1);
+        update_status(status);
+        current = IDLE;
+        return;
+    }
+
+    //decide if unlock attempt is successful or not; when the gesture ended at
+    //the pause that was already scored, the verdict is ready as it is
+    UnlockIndex::Match match = paused_length == segmenter.length() ? paused_match : identify();
+    telemetry_log(TM_SIMILARITY, match.similarity);
+    telemetry_log(TM_IDENTIFY, match.bounded, match.evaluated, template_index.size());
+
+    if (match.id != UnlockIndex::NO_MATCH)
+    {
+        // Gestures match
+        telemetry_log(TM_UNLOCKED);
+        telemetry_log(TM_IDENTIFIED, match.id + 1);
+        counters.unlocks++;
+        char status[32];
+        format_int(format_text(status, "Welcome, user "), match.id + 1);
+        update_status(status);
+        display_success_screen();
+    }
+    else
+    {
+        // Gestures do not match
+        telemetry_log(TM_REJECTED);
+        counters.rejections++;
+        update_status("Failed to unlock");
+        display_wrong_gesture_screen();
+    }
+    PROFILE_STOP(PROF_VERDICT);
+    PROFILE_STOP(PROF_TOUCH_TO_VERDICT); //the first feedback frame is on screen
+}
+
+void App::score_pause()
+{
+    {
+        PROFILE_SCOPE(PROF_RESAMPLE);
+        segmenter.resample(reference_array);
+    }
+    paused_match = identify();
+    paused_length = segmenter.motion_length();
+
+    // the stillness that is left only confirms the gesture is over; once a
+    // user is clearly recognized that is not worth making them wait for.
+    // A low score is not final, the gesture may just be halfway through
+    bool early = paused_match.id != UnlockIndex::NO_MATCH && paused_match.similarity >= EARLY_ACCEPT;
+    if (early)
+    {
+        segmenter.end_early();
+    }
+    telemetry_log(TM_PAUSE_SCORED, paused_length, paused_match.similarity, early);
+}
+
+App::UnlockIndex::Match App::identify()
+{
+    PROFILE_SCOPE(PROF_MATCH);
+    return template_index.identify(reference_array);
+}
+
+void App::load_templates()
+{
+    Gesture gesture;
+    for (int slot = 0; slot < TemplateStore::SLOTS; ++slot)
+    {
+        if (template_store.has(slot) && template_store.load(slot, gesture))
+        {
+            template_index.add(slot, gesture);
+            if (!spotter.add(slot, gesture))
+            {
+                telemetry_log(TM_SPOT_FULL, slot + 1);
+            }
+        }
+    }
+    enrollment = template_index.size() > 0 ? ENROLLED_LOADED : NOT_ENROLLED;
+}
+
+void App::enter_idle()
+{
+    current = IDLE;
+    renderer.invalidate(); //the main screen comes back on the next tick
+}
+
+void App::setup(Gyro &gyro, bool storage_ready)
+{
+    storage_ok = storage_ready;
+
+    // screen
+    setup_screen();
+    calibrate_gyro(gyro);
+    draw_screen();
+
+    // only the template headers are checked here; samples load on first use
+    if (storage_ready && template_store.mount())
+    {
+        int stored = 0;
+        for (int slot = 0; slot < TemplateStore::SLOTS; ++slot)
+        {
+            stored += template_store.has(slot);
+        }
+        if (stored > 0)
+        {
+            enrollment = ENROLLED_STORED;
+            char status[40];
+            format_text(format_int(status, stored), stored == 1 ? " stored gesture found" : " stored gestures found");
+            update_status(status);
+        }
+    }
+    renderer.render();
+}
+
+void App::setup_screen()
+{
+    bool status;
+
+    lcd.SetFont(FONT_20); //set font for display text
+
+    lcd.DisplayStringAt(0, lcd.Line(5), "TOUCHSCREEN DEMO", ALIGN_CENTER); //display initialization message
+    lcd.Present(nullptr, 0);
+    hal_sleep_ms(1);
+
+    status = ts.Init(lcd.GetXSize(), lcd.GetYSize()); //initialize touchscreen
+
+    if (!status) //check initialization status
+    {
+        lcd.Clear(COLOR_RED); //red for failure
+        lcd.SetBackColor(COLOR_RED);
+        lcd.SetTextColor(COLOR_WHITE);
+        lcd.DisplayStringAt(0, lcd.Line(5), "TOUCHSCREEN INIT FAIL", ALIGN_CENTER);
+    }
+    else
+    {
+        lcd.Clear(COLOR_GREEN); //green for success
+        lcd.SetBackColor(COLOR_GREEN);
+        lcd.SetTextColor(COLOR_WHITE);
+        lcd.DisplayStringAt(0, lcd.Line(5), "TOUCHSCREEN INIT OK", ALIGN_CENTER);
+    }
+    lcd.Present(nullptr, 0);
+
+    hal_sleep_ms(1);
+    renderer.set_background(COLOR_BLUE); //default blue background
+    renderer.invalidate();
+}
+
+void App::handle_touch(const TouchEvent &event)
+{
+    if (event.type != TouchEvent::PRESS)
+    {
+        return;
+    }
+
+    last_activity_ms = hal_now_ms();
+    display_touch(event.x, event.y); //show touchscreen coordinates
+    switch (event.target)
+    {
+    case TOUCH_RECORD:
+        begin_capture(RECORDING);
+        break;
+
+    case TOUCH_UNLOCK:
+        begin_capture(UNLOCKING);
+        break;
+    }
+}
+
+void App::display_touch(uint16_t x, uint16_t y)
+{
+    char text[30];
+    format_int(format_text(format_int(format_text(text, "x="), x), " y="), y);
+    renderer.set_text(touch_label, text);
+}
+
+void App::display_xyz(const GyroData &data)
+{
+    PROFILE_SCOPE(PROF_DISPLAY_XYZ);
+    const int16_t raw[3] = {data.x_raw, data.y_raw, data.z_raw};
+
+    // unchanged values cost nothing; the rest repaint only the digits that
+    // differ on the next render()
+    for (int i = 0; i < 3; ++i)
+    {
+        renderer.set_number(value_labels[i], centi_dps(raw[i]), 2);
+        renderer.set_number(value_labels[3 + i], raw[i]);
+    }
+}
+
+void App::draw_screen()
+{
+    static const char *const names[6] = {"X.dps:", "Y.dps:", "Z.dps:", "X.raw:", "Y.raw:", "Z.raw:"};
+
+    // 240x320
+    // Draw Box for labels
+    renderer.add_frame({2, 2, 90, 135}, COLOR_WHITE);
+    // Draw box for values
+    renderer.add_frame({95, 2, 140, 135}, COLOR_WHITE);
+
+    // Draw Text and values, one 20 px row each
+    for (int i = 0; i < 6; ++i)
+    {
+        uint16_t y = 10 + 20 * i;
+        renderer.add_label({5, y, 85, 20}, FONT_20, ALIGN_LEFT, COLOR_WHITE, names[i]);
+        value_labels[i] = renderer.add_label({97, y, 135, 20}, FONT_20, ALIGN_RIGHT, COLOR_WHITE);
+    }
+
+    touch_label = renderer.add_label({0, 144, 240, 16}, FONT_16, ALIGN_LEFT, COLOR_WHITE);
+    status_label = renderer.add_label({0, 176, 240, 16}, FONT_16, ALIGN_LEFT, COLOR_WHITE);
+    count_label = renderer.add_label({0, 200, 240, 20}, FONT_20, ALIGN_LEFT, COLOR_WHITE);
+
+    // Draw Buttons: unlock on the left, record on the right
+    renderer.add_label({10, 224, 100, 20}, FONT_20, ALIGN_CENTER, COLOR_WHITE, "Unlock");
+    renderer.add_frame({10, 250, 100, 50}, COLOR_WHITE);
+    unlock_fill = renderer.add_fill({12, 252, 98, 48}, COLOR_BLUE);
+    renderer.add_label({130, 224, 100, 20}, FONT_20, ALIGN_CENTER, COLOR_WHITE, "Record");
+    renderer.add_frame({130, 250, 100, 50}, COLOR_WHITE);
+    record_fill = renderer.add_fill({132, 252, 98, 48}, COLOR_BLUE);
+
+    calibrated_label = renderer.add_label({0, 310, 240, 8}, FONT_8, ALIGN_LEFT, COLOR_WHITE);
+}
+
+void App::calibrate_gyro(Gyro &gyro)
+{
+    // warm boot: the stored bias is good enough and drift tracking refines it
+    bias_persisted = storage_ok && bias_store.load(persisted_bias);
+    if (bias_persisted)
+    {
+        gyro.set_bias(persisted_bias.x, persisted_bias.y, persisted_bias.z);
+        telemetry_log(TM_BIAS_RESTORED, millicounts(gyro.x_bias), millicounts(gyro.y_bias), millicounts(gyro.z_bias));
+        renderer.set_text(calibrated_label, "GYROSCOPE BIAS RESTORED");
+        return;
+    }
+
+    lcd.SetBackColor(COLOR_GREEN);
+    lcd.DisplayStringAtLine(5, "GYROSCOPE CALIBRATING...");
+    lcd.Present(nullptr, 0);
+
+    uint32_t start = hal_now_ms();
+    if (gyro.calibrate(CALIBRATION_TIMEOUT_MS)) //check if gyro is calibrated
+    {
+        telemetry_log(TM_CALIBRATED, (int32_t)(hal_now_ms() - start), millicounts(gyro.x_bias),
+                      millicounts(gyro.y_bias), millicounts(gyro.z_bias));
+        renderer.set_text(calibrated_label, "GYROSCOPE CALIBRATED");
+        persist_bias();
+    }
+    else
+    {
+        // kept moving: start from zero and let drift tracking find the bias
+        // the first time the board rests
+        telemetry_log(TM_CALIBRATION_TIMEOUT);
+        gyro.set_bias(0.0f, 0.0f, 0.0f);
+        renderer.set_text(calibrated_label, "GYRO BIAS NOT SETTLED");
+    }
+}
+
+void App::persist_bias()
+{
+    BiasStore::Bias bias = {Gyro::x_bias, Gyro::y_bias, Gyro::z_bias};
+    if (!storage_ok ||
+        (bias_persisted &&
+         fabsf(bias.x - persisted_bias.x) < BIAS_PERSIST_COUNTS &&
+         fabsf(bias.y - persisted_bias.y) < BIAS_PERSIST_COUNTS &&
+         fabsf(bias.z - persisted_bias.z) < BIAS_PERSIST_COUNTS))
+    {
+        return;
+    }
+    if (bias_store.save(bias))
+    {
+        persisted_bias = bias;
+        bias_persisted = true;
+    }
+}
+
+void App::display_success_screen()
+{
+    current = SHOWING_SUCCESS;
+    animation_frame = 0;
+    animation_step();
+}
+
+void App::display_wrong_gesture_screen()
+{
+    current = SHOWING_FAILURE;
+    animation_frame = 0;
+    animation_step();
+}
+
+void App::animation_step()
+{
+    animation_event = 0;
+
+    if (current == SHOWING_SUCCESS && animation_frame < SUCCESS_FRAMES)
+    {
+        // Strobe green and black, the last frame is the static green screen
+        bool green = (animation_frame % 2) == 0;
+        draw_banner(green ? COLOR_GREEN : COLOR_BLACK, "SUCCESS");
+        animation_frame++;
+        animation_event = events.call_in(green ? SUCCESS_GREEN_MS : SUCCESS_BLACK_MS, on_animation_step, this);
+    }
+    else if (current == SHOWING_FAILURE && animation_frame == 0)
+    {
+        draw_banner(COLOR_RED, "WRONG GESTURE"); // make it red
+        animation_frame++;
+        animation_event = events.call_in(FAILURE_MS, on_animation_step, this);
+    }
+    else
+    {
+        enter_idle();
+    }
+}
+
+void App::draw_banner(uint32_t color, const char *text)
+{
+    lcd.SetFont(FONT_20);
+    lcd.Clear(color);
+    lcd.SetBackColor(color);
+    lcd.SetTextColor(COLOR_WHITE); // Text color for visibility
+    lcd.DisplayStringAt(0, lcd.Line(6), text, ALIGN_CENTER);
+    lcd.Present(nullptr, 0);
+}
+
+void App::clearButtons()
+{
+    renderer.set_color(record_fill, COLOR_BLUE);
+    renderer.set_color(unlock_fill, COLOR_BLUE);
+}
+
+void App::display_count(int count)
+{
+    renderer.set_number(count_label, count);
+}
+
+void App::capture_block(const GyroData *block, size_t count)
+{
+    GyroData filtered[FilterBank::BLOCK];
+    size_t produced;
+    {
+        PROFILE_SCOPE(PROF_FILTER);
+        produced = filters.process(block, count, filtered);
+    }
+    for (size_t i = 0; i < produced; ++i)
+    {
+        if (current == RECORDING || current == UNLOCKING)
+        {
+            capture_sample(filtered[i]);
+        }
+        else if (spotting && current == IDLE)
+        {
+            spot_sample(filtered[i]);
+        }
+        else
+        {
+            break; //the capture or the spot just ended
+        }
+    }
+}
+
+void App::capture_sample(const GyroData &data)
+{
+    {
+        PROFILE_SCOPE(PROF_PLOT);
+        chart.add(data);
+    }
+
+    switch (segmenter.add(data))
+    {
+    case Segmenter::STARTED:
+        update_status("Capturing...");
+        break;
+
+    case Segmenter::PAUSED:
+        if (current == UNLOCKING)
+        {
+            score_pause();
+        }
+        break;
+
+    case Segmenter::FINISHED:
+        telemetry_log(TM_SEGMENT, segmenter.length());
+        if (current == UNLOCKING)
+        {
+            PROFILE_START(PROF_VERDICT);
+        }
+        if (current == RECORDING || paused_length != segmenter.length())
+        {
+            //the attempt or the key, resampled to the matcher's length and normalized
+            PROFILE_SCOPE(PROF_RESAMPLE);
+            segmenter.resample(current == RECORDING ? recorded_array : reference_array);
+        }
+        finish_capture();
+        break;
+
+    case Segmenter::TIMED_OUT:
+        telemetry_log(TM_SEGMENT_TIMEOUT);
+        chart.show(false);
+        clearButtons();
+        update_status("No gesture detected");
+        current = IDLE;
+        break;
+
+    case Segmenter::NONE:
+        break;
+    }
+}
+
+void App::spot_sample(const GyroData &data)
+{
+    GestureSpotter::Spot spot;
+    bool found;
+    {
+        PROFILE_SCOPE(PROF_SPOT);
+        found = spotter.push(data, spot);
+    }
+    if (!found)
+    {
+        return;
+    }
+
+    telemetry_log(TM_SPOTTED, spot.id + 1, spot.similarity, (int32_t)(spot.end - spot.start));
+    counters.spotted++;
+    spotting = false;
+    char status[32];
+    format_int(format_text(status, "Welcome, user "), spot.id + 1);
+    update_status(status);
+    display_success_screen();
+}
+
+void App::print_sampler_stats()
+{
+    Sampler::Stats stats = sampler.stats();
+    telemetry_log(TM_SAMPLER_STATS, stats.samples, stats.ring_drops, stats.fifo_overruns);
+    telemetry_log(TM_SAMPLER_TIMING, stats.min_interval_us, stats.mean_interval_us, stats.max_interval_us,
+                  sampler.jitter_us());
+}
+
+void App::update_status(const char *status)
+{
+    renderer.set_text(status_label, status);
+}
@@ -0,0 +1,173 @@
+#ifndef APP_HPP
+#define APP_HPP
+
+#include <cstdint>
+
+#include "bias_store.hpp"
+#include "gesture_spotter.hpp"
+#include "filter_bank.hpp"
+#include "gyroscope.hpp"
+#include "hal.hpp"
+#include "match_policy.hpp"
+#include "matcher.hpp"
+#include "power_manager.hpp"
+#include "renderer.hpp"
+#include "sampler.hpp"
+#include "segmenter.hpp"
+#include "strip_chart.hpp"
+#include "template_index.hpp"
+#include "template_store.hpp"
+#include "touch_input.hpp"
+
+// The metric the unlock path is built with, any policy from match_policy.hpp.
+// Time-warped matching tolerates speed differences between attempts.
+typedef DtwMatcher UnlockMatcher;
+
+// The record/unlock application. It only talks to the board through the HAL,
+// so main.cpp runs it on the DISCO-F429ZI and host_main.cpp replays recorded
+// traces through exactly the same code.
+//
+// Everything runs from an EventLoop: a periodic tick consumes samples, polls
+// touch and repaints, and the feedback animations are chains of timed events.
+// Nothing sleeps, so sampling continues and a new attempt can start while an
+// animation is still playing. After IDLE_TIMEOUT_MS without a touch, a
+// capture or motion the tick stops and the PowerManager dozes until a touch
+// or motion wakes it.
+class App
+{
+public:
+    static const uint32_t TICK_MS = 25;       //UI tick period
+    static const uint32_t CALIBRATION_TIMEOUT_MS = 1000; //cold start gives up after this if the board keeps moving
+    static constexpr float BIAS_PERSIST_COUNTS = 2.0f;   //drift that is worth an EEPROM write
+    static const uint32_t IDLE_TIMEOUT_MS = 30000;       //doze after this long with nothing happening
+
+    enum State
+    {
+        IDLE,            //waiting for a button
+        RECORDING,       //waiting for and capturing the gesture to enroll
+        UNLOCKING,       //waiting for and capturing an unlock attempt
+        SHOWING_SUCCESS, //strobing the success screen
+        SHOWING_FAILURE  //holding the wrong gesture screen
+    };
+
+    // counters the host simulation reports
+    struct Results
+    {
+        uint32_t recordings;
+        uint32_t unlocks;
+        uint32_t rejections;
+        uint32_t spotted; //unlocks found by the always-on spotter
+    };
+
+    App(Display &display, Touch &touch, Sampler &sampler, PowerManager &power, TemplateStore &store,
+        BiasStore &bias_store, EventLoop &events);
+
+    void setup(Gyro &gyro, bool storage_ready); //sets up application environment, calibrating the gyro if needed
+    void start(); //schedules the UI tick; the caller then dispatches the event loop
+
+    // Always-on mode: while idle, the live stream is searched for every
+    // enrolled gesture and finding one unlocks without an Unlock press.
+    void set_always_on(bool enabled);
+
+    State state() const;
+    Results results() const;
+    GestureSpotter::Stats spotter_stats() const;
+
+private:
+    Display &lcd; //object to handle LCD display functionalities
+    Touch &ts; //object to handle touchscreen functionalities
+    Sampler &sampler; //real-time sample source
+    PowerManager &power; //dozes the board while nobody uses it
+    TemplateStore &template_store; //enrolled gestures that survive a power cycle
+    BiasStore &bias_store; //last good gyro bias, lets a warm boot skip calibration
+    EventLoop &events; //runs the tick and the animations
+    Renderer renderer; //repaints only the widgets that changed
+    StripChart chart; //live plot of the gesture being captured
+    TouchInput touch_input; //debounced, hit-tested presses from the touch interrupt
+
+    // ----- Widgets -----
+    int value_labels[6] = {}; //x/y/z dps, then x/y/z raw
+    int touch_label = -1; //last touch coordinates
+    int status_label = -1; //status messages
+    int count_label = -1; //sample count while recording/unlocking
+    int record_fill = -1; //button faces, coloured while active
+    int unlock_fill = -1;
+    int calibrated_label = -1;
+
+    typedef TemplateIndex<UnlockMatcher> UnlockIndex;
+
+    // ----- Arrays to store movement sequences -----
+    Gesture reference_array = {}; // Q15 movement sequence of the unlock attempt
+    Gesture recorded_array = {};  // Q15 movement sequence being enrolled
+    UnlockIndex::Match paused_match = {}; //unlock attempt scored at its latest pause
+    int paused_length = 0; //gesture length paused_match was scored at, 0 if none
+
+    // every enrolled gesture, searched to identify who is unlocking
+    UnlockIndex::Entry index_entries[TemplateStore::SLOTS];
+    UnlockIndex template_index{index_entries, TemplateStore::SLOTS};
+
+    GestureSpotter spotter; //finds enrolled gestures in the stream while idle
+    static_assert(GestureSpotter::MAX_TEMPLATES >= TemplateStore::SLOTS, "every enrolled user must be spotted");
+    bool always_on = false; //spotter runs whenever the app is idle
+    bool spotting = false; //the spotter is following the stream right now
+
+    GyroData data = {}; //newest sample, drives the display
+    FilterBank filters; //low-pass and decimation ahead of the segmenter
+    Segmenter segmenter; //finds the gesture in the filtered stream
+
+    enum Enrollment
+    {
+        NOT_ENROLLED,
+        ENROLLED_STORED, //gestures are in the template store but not loaded yet
+        ENROLLED_LOADED  //template_index holds every enrolled gesture
+    };
+
+    State current = IDLE; //where the record/unlock flow is
+    Enrollment enrollment = NOT_ENROLLED;
+    int animation_event = 0; //pending animation step, 0 when none
+    int animation_frame = 0; //frames shown by the running animation
+    int tick_event = 0; //the running UI tick, 0 while dozing
+    uint32_t last_activity_ms = 0; //last touch, capture step or motion
+
+    bool storage_ok = false; //non-volatile storage is usable
+    BiasStore::Bias persisted_bias = {}; //bias as last written to storage
+    bool bias_persisted = false; //persisted_bias is valid
+    uint32_t bias_updates_seen = 0; //sampler drift corrections already considered
+
+    Results counters = {};
+
+    static void on_tick(void *app);
+    static void on_animation_step(void *app);
+    static void on_contact(void *app);
+    static void on_wake(void *app);
+
+    void tick(); //one pass of the UI: samples, capture, touch, repaint
+    void animation_step(); //next frame of the feedback animation
+    void doze(); //stops the tick and hands over to the PowerManager
+    void begin_capture(State mode); //starts recording or unlocking
+    void finish_capture(); //stores or identifies a completed capture
+    void score_pause(); //identifies the attempt as it would end at this pause
+    UnlockIndex::Match identify(); //searches every enrolled gesture for reference_array
+    void load_templates(); //reads every stored gesture into the index
+    void enter_idle(); //back to the main screen
+    void draw_banner(uint32_t color, const char *text); //full screen feedback frame
+
+    void calibrate_gyro(Gyro &gyro); //restores or estimates the gyro bias
+    void persist_bias(); //writes the bias back once drift has moved it enough
+    void setup_screen(); //initializes the screen
+    void display_xyz(const GyroData &data); //displays gyroscope data on screen
+    void draw_screen(); //ui elements on the LCD
+    void handle_touch(const TouchEvent &event); //acts on a debounced press
+    void display_touch(uint16_t x, uint16_t y); //displays touchscreen coordinates on the screen
+    void display_success_screen(); //starts the "success" strobe if unlock attempt is successful
+    void display_wrong_gesture_screen(); //shows an error message if unlock attempt is unsuccessful
+    void display_count(int count); //displays the current sample count during recording/unlocking
+    void clearButtons(); //resets the button on the screen
+    void update_status(const char *status); //updates status messages on the screen
+    void capture_block(const GyroData *block, size_t count); //filters full rate samples and feeds the segmenter or spotter
+    void capture_sample(const GyroData &data); //feeds a sample to the segmenter and acts on its events
+    void spot_sample(const GyroData &data); //feeds an idle sample to the spotter and unlocks on a spot
+    void print_sampler_stats(); //reports drops and timing of the acquisition thread
+};
+
+#endif // APP_HPP
@@ -0,0 +1,72 @@
+#include "bias_estimator.hpp"
+
+void BiasEstimator::reset()
+{
+    n = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        means[k] = 0.0f;
+        m2[k] = 0.0f;
+    }
+}
+
+void BiasEstimator::add(int16_t x, int16_t y, int16_t z)
+{
+    const float sample[3] = {(float)x, (float)y, (float)z};
+
+    n++;
+    for (int k = 0; k < 3; ++k)
+    {
+        float delta = sample[k] - means[k];
+        means[k] += delta / n;
+        m2[k] += delta * (sample[k] - means[k]);
+    }
+}
+
+uint32_t BiasEstimator::count() const
+{
+    return n;
+}
+
+float BiasEstimator::mean(int axis) const
+{
+    return means[axis];
+}
+
+float BiasEstimator::variance(int axis) const
+{
+    return n > 1 ? m2[axis] / (n - 1) : 0.0f;
+}
+
+bool BiasEstimator::stationary() const
+{
+    if (n < MIN_SAMPLES)
+    {
+        return true;
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+        if (variance(k) > STILL_VARIANCE)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BiasEstimator::converged() const
+{
+    if (n < MIN_SAMPLES || !stationary())
+    {
+        return false;
+    }
+    // squared standard error of the mean is variance / n
+    for (int k = 0; k < 3; ++k)
+    {
+        if (variance(k) > TOLERANCE * TOLERANCE * n)
+        {
+            return false;
+        }
+    }
+    return true;
+}
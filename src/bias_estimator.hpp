@@ -0,0 +1,36 @@
+#ifndef BIAS_ESTIMATOR_HPP
+#define BIAS_ESTIMATOR_HPP
+
+#include <cstdint>
+
+// Streaming (Welford) mean and variance of the three gyro axes. While the
+// board is still the variance sits at the noise floor and the mean converges
+// on the zero-rate bias, so calibration can stop as soon as the standard
+// error is small enough rather than after a fixed number of samples.
+class BiasEstimator
+{
+public:
+    static constexpr float STILL_VARIANCE = 80.0f * 80.0f; // counts^2, 0.7 dps rms; gestures are far above
+    static constexpr float TOLERANCE = 4.0f;               // standard error of the mean, counts (35 mdps)
+    static const uint32_t MIN_SAMPLES = 16;                // before the variance is trusted
+
+    void reset();
+    void add(int16_t x, int16_t y, int16_t z);
+
+    uint32_t count() const;
+    float mean(int axis) const;
+    float variance(int axis) const;
+
+    // no axis has moved more than the noise floor so far
+    bool stationary() const;
+
+    // stationary, and every mean is known within TOLERANCE
+    bool converged() const;
+
+private:
+    uint32_t n = 0;
+    float means[3] = {};
+    float m2[3] = {}; // sum of squared deviations from the running mean
+};
+
+#endif // BIAS_ESTIMATOR_HPP
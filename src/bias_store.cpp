@@ -0,0 +1,94 @@
+#include "bias_store.hpp"
+
+#include <cstddef>
+
+#include "template_store.hpp"
+
+static const uint32_t MAGIC = 0x47424941; // "GBIA"
+static const float SCALE = 16.0f;         // stored in 1/16 count
+
+static int16_t to_fixed(float counts)
+{
+    float scaled = counts * SCALE;
+    if (scaled > 32767.0f)
+    {
+        return 32767;
+    }
+    if (scaled < -32768.0f)
+    {
+        return -32768;
+    }
+    return (int16_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+BiasStore::BiasStore(Storage &storage, uint32_t base) : storage(storage), base(base)
+{
+}
+
+uint32_t BiasStore::end() const
+{
+    return base + COPIES * RECORD_SIZE;
+}
+
+bool BiasStore::read_record(int copy, Record &record)
+{
+    return storage.read(base + copy * RECORD_SIZE, (uint8_t *)&record, sizeof(record)) &&
+           record.magic == MAGIC &&
+           record.crc == crc16((const uint8_t *)&record, offsetof(Record, crc));
+}
+
+bool BiasStore::load(Bias &out)
+{
+    if (end() > storage.size())
+    {
+        return false;
+    }
+
+    newest = -1;
+    sequence = 0;
+    Record record;
+    for (int c = 0; c < COPIES; ++c)
+    {
+        if (read_record(c, record) && record.sequence > sequence)
+        {
+            newest = c;
+            sequence = record.sequence;
+            out.x = record.bias[0] / SCALE;
+            out.y = record.bias[1] / SCALE;
+            out.z = record.bias[2] / SCALE;
+        }
+    }
+    return newest >= 0;
+}
+
+bool BiasStore::save(const Bias &bias)
+{
+    if (end() > storage.size() || RECORD_SIZE % storage.page_size() != 0)
+    {
+        return false;
+    }
+
+    Record record;
+    record.magic = MAGIC;
+    record.sequence = sequence + 1;
+    record.bias[0] = to_fixed(bias.x);
+    record.bias[1] = to_fixed(bias.y);
+    record.bias[2] = to_fixed(bias.z);
+    record.crc = crc16((const uint8_t *)&record, offsetof(Record, crc));
+
+    // overwrite the older copy; the CRC only matches once every page landed
+    int copy = (newest + 1) % COPIES;
+    uint32_t addr = base + copy * RECORD_SIZE;
+    const uint32_t page = storage.page_size();
+    for (uint32_t offset = 0; offset < RECORD_SIZE; offset += page)
+    {
+        if (!storage.write(addr + offset, (const uint8_t *)&record + offset, page))
+        {
+            return false;
+        }
+    }
+
+    newest = copy;
+    sequence = record.sequence;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef BIAS_STORE_HPP
+#define BIAS_STORE_HPP
+
+#include <cstdint>
+
+#include "storage.hpp"
+
+// The last good gyro bias, kept in non-volatile storage so a warm boot can
+// skip calibration. Two CRC-checked copies are written alternately, so a
+// reset mid-write always leaves the previous bias readable.
+class BiasStore
+{
+public:
+    static const int COPIES = 2;
+    static const uint32_t RECORD_SIZE = 16; // multiple of every page size we use
+
+    struct Bias
+    {
+        float x, y, z; // raw counts
+    };
+
+    BiasStore(Storage &storage, uint32_t base);
+
+    bool load(Bias &out);
+    bool save(const Bias &bias);
+
+    uint32_t end() const;
+
+private:
+    struct Record
+    {
+        uint32_t magic;
+        uint32_t sequence;  // higher is newer
+        int16_t bias[3];    // 1/16 count
+        uint16_t crc;       // over the bytes above
+    };
+
+    static_assert(sizeof(Record) == RECORD_SIZE, "record layout must stay stable");
+
+    Storage &storage;
+    uint32_t base;
+    int newest = -1; // copy load() found, -1 if none
+    uint32_t sequence = 0;
+
+    bool read_record(int copy, Record &record);
+};
+
+#endif // BIAS_STORE_HPP
@@ -0,0 +1,147 @@
+#include "dtw.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+#include "telemetry.hpp"
+
+uint32_t dtw_distance(const Gesture &a, const Gesture &b, int band, uint32_t limit)
+{
+    if (band > DTW_MAX_BAND)
+    {
+        band = DTW_MAX_BAND;
+    }
+
+    // cell k of a row holds column j = i - band + k
+    const int width = 2 * band + 1;
+    uint32_t rows[2][2 * DTW_MAX_BAND + 1];
+    uint32_t *prev = rows[0];
+    uint32_t *curr = rows[1];
+
+    for (int k = 0; k < width; ++k)
+    {
+        prev[k] = DTW_INFINITY;
+    }
+
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        uint32_t row_min = DTW_INFINITY;
+        const int32_t ax = a.axis[0][i], ay = a.axis[1][i], az = a.axis[2][i];
+
+        for (int k = 0; k < width; ++k)
+        {
+            int j = i - band + k;
+            if (j < 0 || j >= SAMPLES)
+            {
+                curr[k] = DTW_INFINITY;
+                continue;
+            }
+
+            uint32_t best;
+            if (i == 0 && j == 0)
+            {
+                best = 0;
+            }
+            else
+            {
+                best = prev[k]; // (i - 1, j - 1)
+                if (k + 1 < width && prev[k + 1] < best)
+                {
+                    best = prev[k + 1]; // (i - 1, j)
+                }
+                if (k > 0 && curr[k - 1] < best)
+                {
+                    best = curr[k - 1]; // (i, j - 1)
+                }
+            }
+
+            uint32_t cost = dtw_square(ax - b.axis[0][j]) + dtw_square(ay - b.axis[1][j]) + dtw_square(az - b.axis[2][j]);
+            curr[k] = (best > DTW_INFINITY - cost) ? DTW_INFINITY : best + cost;
+            if (curr[k] < row_min)
+            {
+                row_min = curr[k];
+            }
+        }
+
+        // every warping path crosses this row, so none can end below row_min
+        if (row_min > limit)
+        {
+            return DTW_INFINITY;
+        }
+
+        uint32_t *tmp = prev;
+        prev = curr;
+        curr = tmp;
+    }
+
+    return prev[band];
+}
+
+int32_t dtw_similarity(const Gesture &gesture1, const Gesture &gesture2)
+{
+    uint32_t cost = dtw_distance(gesture1, gesture2, DTW_BAND, DTW_ACCEPT_LIMIT);
+    if (cost == DTW_INFINITY)
+    {
+        telemetry_log(TM_DTW_ABANDONED, (int32_t)DTW_ACCEPT_LIMIT);
+        return 0;
+    }
+
+    int32_t similarity = dtw_cost_similarity(cost);
+    telemetry_log(TM_DTW_COST, (int32_t)cost, similarity);
+
+    return similarity;
+}
+
+int32_t dtw_cost_similarity(uint32_t cost)
+{
+    // similarity = 1 / (1 + scale * cost / (SAMPLES * 3)), Q22 mean down to Q15
+    uint32_t mean = (cost / (SAMPLES * 3)) >> 7;
+    return (int32_t)((1u << 30) / (uint32_t)(Q15_ONE + DTW_COST_SCALE * mean));
+}
+
+float reference_dtw_distance(const Gesture &a, const Gesture &b, int band)
+{
+    float rows[2][SAMPLES];
+    float *prev = rows[0];
+    float *curr = rows[1];
+
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        for (int j = 0; j < SAMPLES; ++j)
+        {
+            if (abs(i - j) > band)
+            {
+                curr[j] = INFINITY;
+                continue;
+            }
+
+            float cost = 0.0f;
+            for (int k = 0; k < 3; ++k)
+            {
+                float diff = (a.axis[k][i] - b.axis[k][j]) / 32768.0f;
+                cost += diff * diff;
+            }
+
+            float best = (i == 0 && j == 0) ? 0.0f : INFINITY;
+            if (i > 0)
+            {
+                best = fminf(best, prev[j]);
+            }
+            if (j > 0)
+            {
+                best = fminf(best, curr[j - 1]);
+            }
+            if (i > 0 && j > 0)
+            {
+                best = fminf(best, prev[j - 1]);
+            }
+            curr[j] = best + cost;
+        }
+
+        float *tmp = prev;
+        prev = curr;
+        curr = tmp;
+    }
+
+    return prev[SAMPLES - 1];
+}
@@ -0,0 +1,46 @@
+#ifndef DTW_HPP
+#define DTW_HPP
+
+#include "matcher.hpp"
+
+// Dynamic Time Warping matcher. Unlike calculate_similarity() it lets the two
+// gestures drift in time against each other, so doing the same motion a bit
+// faster or slower than at enrollment still lines up.
+
+constexpr int DTW_BAND = 6;      //Sakoe-Chiba radius in samples (20% of SAMPLES)
+constexpr int DTW_MAX_BAND = 16; //upper bound for the rolling row buffers
+
+// maps the mean per-sample cost onto (0, 1] like 1 / (1 + mse) does, scaled
+// so the cost of a sloppy but genuine repeat still clears ACCEPT_THRESHOLD
+constexpr int32_t DTW_COST_SCALE = 50;
+
+// costs are sums of squared Q15 differences kept in Q22
+constexpr uint32_t DTW_INFINITY = UINT32_MAX;
+
+// (1 / ACCEPT_THRESHOLD - 1) * SAMPLES * 3 / DTW_COST_SCALE in Q22: the cost
+// at which dtw_similarity() drops to the accept threshold
+constexpr uint32_t DTW_ACCEPT_LIMIT =
+    (uint32_t)(((double)Q15_ONE / ACCEPT_THRESHOLD - 1.0) * (SAMPLES * 3) / DTW_COST_SCALE * (1 << 22));
+
+// squared difference of two Q15 values in Q22, the per-axis cell cost
+inline uint32_t dtw_square(int32_t diff)
+{
+    uint32_t magnitude = (uint32_t)(diff < 0 ? -diff : diff);
+    return (magnitude * magnitude + 128) >> 8; // Q30 square rounded to Q22
+}
+
+// Banded DTW using squared Euclidean distance per sample. Only two rows of
+// 2 * band + 1 cells are kept. Returns DTW_INFINITY as soon as every cell of
+// a row exceeds `limit`, since the final cost can only grow.
+uint32_t dtw_distance(const Gesture &a, const Gesture &b, int band, uint32_t limit);
+
+// drop-in alternative to calculate_similarity(), Q15 result
+int32_t dtw_similarity(const Gesture &gesture1, const Gesture &gesture2);
+
+// the Q15 similarity dtw_similarity() reports for a finite dtw_distance()
+int32_t dtw_cost_similarity(uint32_t cost);
+
+// float reference of dtw_distance() without abandoning, same scale (1.0 = 1.0)
+float reference_dtw_distance(const Gesture &a, const Gesture &b, int band);
+
+#endif // DTW_HPP
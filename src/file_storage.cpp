@@ -0,0 +1,69 @@
+#include "file_storage.hpp"
+
+FileStorage::FileStorage(uint32_t size, uint32_t page_size) : capacity(size), page(page_size)
+{
+}
+
+FileStorage::~FileStorage()
+{
+    if (file)
+    {
+        fclose(file);
+    }
+}
+
+bool FileStorage::open(const char *path)
+{
+    if (!path)
+    {
+        file = tmpfile();
+    }
+    else if (!(file = fopen(path, "r+b")))
+    {
+        file = fopen(path, "w+b");
+    }
+    if (!file)
+    {
+        return false;
+    }
+
+    // pad to the full size so every address reads back as erased memory
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    for (long i = length; i < (long)capacity; ++i)
+    {
+        fputc(0xFF, file);
+    }
+    return fflush(file) == 0;
+}
+
+uint32_t FileStorage::size() const
+{
+    return capacity;
+}
+
+uint32_t FileStorage::page_size() const
+{
+    return page;
+}
+
+bool FileStorage::read(uint32_t addr, uint8_t *buf, size_t len)
+{
+    if (!file || addr + len > capacity)
+    {
+        return false;
+    }
+    fseek(file, addr, SEEK_SET);
+    return fread(buf, 1, len, file) == len;
+}
+
+bool FileStorage::write(uint32_t addr, const uint8_t *buf, size_t len)
+{
+    if (!file || addr + len > capacity || addr / page != (addr + len - 1) / page)
+    {
+        return false;
+    }
+    fseek(file, addr, SEEK_SET);
+    bytes_written += len;
+    return fwrite(buf, 1, len, file) == len && fflush(file) == 0;
+}
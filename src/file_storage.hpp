@@ -0,0 +1,34 @@
+#ifndef FILE_STORAGE_HPP
+#define FILE_STORAGE_HPP
+
+#include <cstdio>
+
+#include "storage.hpp"
+
+// Storage backed by a plain file, standing in for the EEPROM on a host.
+// A fresh file reads as erased (0xFF) memory.
+class FileStorage : public Storage
+{
+private:
+    FILE *file = nullptr;
+    uint32_t capacity;
+    uint32_t page;
+
+public:
+    FileStorage(uint32_t size, uint32_t page_size);
+    ~FileStorage();
+
+    // null opens an anonymous temporary file that is gone once closed
+    bool open(const char *path);
+
+    // bytes written so far, to compare wear across runs
+    uint32_t bytes_written = 0;
+
+    uint32_t size() const override;
+    uint32_t page_size() const override;
+
+    bool read(uint32_t addr, uint8_t *buf, size_t len) override;
+    bool write(uint32_t addr, const uint8_t *buf, size_t len) override;
+};
+
+#endif // FILE_STORAGE_HPP
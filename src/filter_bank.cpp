@@ -0,0 +1,137 @@
+#include "filter_bank.hpp"
+
+#include <cstring>
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include "cmsis.h"
+#define FILTER_BANK_SIMD 1
+#else
+#define FILTER_BANK_SIMD 0
+#endif
+
+// Butterworth sections for fc = 20 Hz at ODR 100, 200, 400 and 800 Hz. The
+// feed-forward terms are rounded so each section has exactly unity gain at
+// DC, and the sum of |coefficients| stays below 2^16 so no accumulator can
+// overflow 32 bits, even with the carried error on top.
+static const Biquad LOW_PASS[4][FilterBank::SECTIONS] = {
+    {{3013, 6026, 3013, 5390, -1058}, {4150, 8300, 4150, 7424, -7640}},
+    {{1014, 2028, 1014, 17180, -4852}, {1277, 2555, 1277, 21642, -10367}},
+    {{312, 624, 312, 24243, -9107}, {358, 718, 358, 27869, -12919}},
+    {{88, 176, 88, 28278, -12246}, {95, 190, 95, 30537, -14533}},
+};
+
+static const int32_t FRACTION = (1 << 14) - 1; // the bits of a Q14 sum below the output LSB
+
+static constexpr int odr_index(uint32_t odr_hz)
+{
+    return odr_hz == 100 ? 0 : odr_hz == 200 ? 1 : odr_hz == 400 ? 2 : 3;
+}
+
+static inline int16_t saturate(int32_t value)
+{
+#if FILTER_BANK_SIMD
+    return (int16_t)__SSAT(value, 16);
+#else
+    return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t)value;
+#endif
+}
+
+FilterBank::FilterBank(uint32_t odr_hz) : sections(low_pass(odr_hz)), decimation((int)(odr_hz / OUTPUT_HZ))
+{
+    reset();
+}
+
+const Biquad *FilterBank::low_pass(uint32_t odr_hz)
+{
+    return LOW_PASS[odr_index(odr_hz)];
+}
+
+void FilterBank::reset()
+{
+    memset(state, 0, sizeof(state));
+    phase = 0;
+}
+
+void FilterBank::run_section(const Biquad &c, int16_t *history, int16_t *samples, size_t count)
+{
+    int16_t x1 = history[0], x2 = history[1], y1 = history[2], y2 = history[3];
+    int32_t error = history[4];
+
+#if FILTER_BANK_SIMD
+    const uint32_t b0_b1 = __PKHBT(c.b0, c.b1, 16);
+    const uint32_t b2_a1 = __PKHBT(c.b2, c.a1, 16);
+#endif
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        int16_t x0 = samples[i];
+#if FILTER_BANK_SIMD
+        int32_t acc = error + c.a2 * y2;
+        acc = __SMLAD(__PKHBT(x2, y1, 16), b2_a1, acc);
+        acc = __SMLAD(__PKHBT(x0, x1, 16), b0_b1, acc);
+#else
+        int32_t acc = error + c.a2 * y2;
+        acc += c.b2 * x2 + c.a1 * y1;
+        acc += c.b0 * x0 + c.b1 * x1;
+#endif
+        // Error feedback: what the shift drops is added back into the next
+        // sum. Plain rounding leaves these poles, this close to z = 1, a
+        // dead band of up to tens of LSB around a constant input. Carried
+        // over, the error averages out, so a constant settles exactly.
+        error = acc & FRACTION;
+        int16_t y0 = saturate(acc >> 14);
+
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = y0;
+        samples[i] = y0;
+    }
+
+    history[0] = x1;
+    history[1] = x2;
+    history[2] = y1;
+    history[3] = y2;
+    history[4] = (int16_t)error;
+}
+
+size_t FilterBank::process(const GyroData *in, size_t count, GyroData *out)
+{
+    if (count > BLOCK)
+    {
+        count = BLOCK;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        axis[0][i] = in[i].x_raw;
+        axis[1][i] = in[i].y_raw;
+        axis[2][i] = in[i].z_raw;
+    }
+
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int s = 0; s < SECTIONS; ++s)
+        {
+            run_section(sections[s], state[k][s], axis[k], count);
+        }
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (phase == 0)
+        {
+            GyroData &sample = out[written++];
+            sample.x_raw = axis[0][i];
+            sample.y_raw = axis[1][i];
+            sample.z_raw = axis[2][i];
+            sample.x_dps = sample.x_raw * GyroConfig::SENSITIVITY;
+            sample.y_dps = sample.y_raw * GyroConfig::SENSITIVITY;
+            sample.z_dps = sample.z_raw * GyroConfig::SENSITIVITY;
+        }
+        phase = phase + 1 == decimation ? 0 : phase + 1;
+    }
+
+    return written;
+}
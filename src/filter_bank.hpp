@@ -0,0 +1,60 @@
+#ifndef FILTER_BANK_HPP
+#define FILTER_BANK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gyroscope.hpp"
+
+// One second-order section in Q14. The feedback coefficients are stored
+// negated so every term is a multiply-accumulate:
+// y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+struct Biquad
+{
+    int16_t b0, b1, b2, a1, a2;
+};
+
+// Signal conditioning between the sampler and the segmenter. Each axis runs
+// through a cascade of biquads (a 4th order Butterworth low-pass at 20 Hz)
+// and the result is decimated to OUTPUT_HZ, whatever the sensor ODR: 100,
+// 200, 400 or 800 Hz.
+//
+// Blocks are filtered one axis at a time with the Cortex-M4 dual 16-bit MAC
+// (SMLAD) when the compiler targets the DSP extension, and with plain
+// integer code otherwise. Both carry the quantization error and saturate the
+// same way and give bit-identical output.
+class FilterBank
+{
+public:
+    static const uint32_t OUTPUT_HZ = 100;
+    static const int SECTIONS = 2;
+    static const size_t BLOCK = Gyro::FIFO_DEPTH; // most samples per process() call
+
+    static_assert(Gyro::ODR_HZ % OUTPUT_HZ == 0, "ODR must be a multiple of the output rate");
+
+    explicit FilterBank(uint32_t odr_hz = Gyro::ODR_HZ);
+
+    // the SECTIONS coefficient sets used at `odr_hz`
+    static const Biquad *low_pass(uint32_t odr_hz);
+
+    // clears the filter history and the decimation phase
+    void reset();
+
+    // Filters up to BLOCK consecutive full-rate samples and writes every
+    // ODR / OUTPUT_HZ-th result to `out`. Returns how many were written.
+    size_t process(const GyroData *in, size_t count, GyroData *out);
+
+private:
+    const Biquad *sections; // SECTIONS coefficient sets for the configured ODR
+    int decimation;         // full-rate samples per output
+
+    // x[n-1], x[n-2], y[n-1], y[n-2] and the carried error per axis and section
+    int16_t state[3][SECTIONS][5];
+    int phase = 0; // full-rate samples until the next output
+
+    int16_t axis[3][BLOCK]; // the block being filtered, one row per axis
+
+    void run_section(const Biquad &c, int16_t *history, int16_t *samples, size_t count);
+};
+
+#endif // FILTER_BANK_HPP
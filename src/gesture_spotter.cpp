@@ -0,0 +1,215 @@
+#include "gesture_spotter.hpp"
+
+// gestures of about 0.9 s to 4.8 s at the segmenter's 100 Hz, each scale
+// ~1.4x the last
+const int GestureSpotter::STEPS[SCALES] = {3, 4, 6, 8, 11, 16};
+
+static uint32_t add_saturated(uint32_t a, uint32_t b)
+{
+    return a > DTW_INFINITY - b ? DTW_INFINITY : a + b;
+}
+
+GestureSpotter::GestureSpotter()
+{
+    reset();
+}
+
+void GestureSpotter::clear(Track &track)
+{
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        track.cost[i] = DTW_INFINITY;
+        track.start[i] = 0;
+    }
+    track.best = DTW_INFINITY;
+    track.best_start = 0;
+    track.best_end = 0;
+}
+
+void GestureSpotter::reset()
+{
+    position = 0;
+    for (int s = 0; s < SCALES; ++s)
+    {
+        boxes[s] = {{0, 0, 0}, 0, 0};
+        for (int t = 0; t < MAX_TEMPLATES; ++t)
+        {
+            clear(tracks[t][s]);
+        }
+    }
+}
+
+bool GestureSpotter::add(int id, const Gesture &gesture)
+{
+    int t = 0;
+    while (t < count && ids[t] != id)
+    {
+        ++t;
+    }
+    if (t == MAX_TEMPLATES)
+    {
+        return false;
+    }
+    if (t == count)
+    {
+        ids[count++] = id;
+    }
+    templates[t] = gesture;
+    for (int s = 0; s < SCALES; ++s)
+    {
+        clear(tracks[t][s]);
+    }
+    return true;
+}
+
+// One new column. Cell i is the best path ending with template point i
+// matched to `point`: from the previous column's i - 1 (diagonal) or i, or
+// from this column's i - 1. Above the first point sits a free cell of cost 0
+// in every column, which is what lets a path start at any box.
+void GestureSpotter::step(Track &track, const Gesture &gesture, const int32_t point[3], uint32_t start)
+{
+    uint32_t diag = 0, diag_start = start;   // the previous column, one point back
+    uint32_t below = 0, below_start = start; // this column, one point back
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        uint32_t up = track.cost[i], up_start = track.start[i];
+
+        uint32_t best = diag, best_start = diag_start;
+        if (up < best)
+        {
+            best = up;
+            best_start = up_start;
+        }
+        if (below < best)
+        {
+            best = below;
+            best_start = below_start;
+        }
+
+        uint32_t cell = dtw_square(point[0] - gesture.axis[0][i]) + dtw_square(point[1] - gesture.axis[1][i]) +
+                        dtw_square(point[2] - gesture.axis[2][i]);
+        cell = add_saturated(best, cell);
+
+        track.cost[i] = cell;
+        track.start[i] = best_start;
+        diag = up;
+        diag_start = up_start;
+        below = cell;
+        below_start = best_start;
+    }
+}
+
+// SPRING's report condition: every path still running either costs more
+// than the pending match already, or starts after it ends and so cannot
+// replace it
+bool GestureSpotter::final(const Track &track) const
+{
+    if (track.best == DTW_INFINITY)
+    {
+        return false;
+    }
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        if (track.cost[i] < track.best && track.start[i] < track.best_end)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GestureSpotter::suppress(uint32_t end)
+{
+    for (int t = 0; t < count; ++t)
+    {
+        for (int s = 0; s < SCALES; ++s)
+        {
+            Track &track = tracks[t][s];
+            if (track.best != DTW_INFINITY && track.best_start < end)
+            {
+                track.best = DTW_INFINITY;
+            }
+            for (int i = 0; i < SAMPLES; ++i)
+            {
+                if (track.start[i] < end)
+                {
+                    track.cost[i] = DTW_INFINITY;
+                }
+            }
+        }
+    }
+}
+
+bool GestureSpotter::push(const GyroData &sample, Spot &spot)
+{
+    const int16_t values[3] = {sample.x_raw, sample.y_raw, sample.z_raw};
+    uint32_t cells = 0;
+    int found = -1; // template of the spot
+    uint32_t found_cost = DTW_INFINITY;
+    position++;
+
+    for (int s = 0; s < SCALES; ++s)
+    {
+        Box &box = boxes[s];
+        for (int k = 0; k < 3; ++k)
+        {
+            box.sums[k] += values[k];
+        }
+        if (++box.count < STEPS[s])
+        {
+            continue;
+        }
+
+        // a full box is one more stream point at this scale, averaged like
+        // Segmenter::resample() averages a gesture
+        int32_t point[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            point[k] = normalize((int16_t)(box.sums[k] / box.count));
+        }
+        for (int t = 0; t < count; ++t)
+        {
+            Track &track = tracks[t][s];
+            step(track, templates[t], point, box.start);
+
+            // the best of the matches that became final with this sample
+            if (final(track) && track.best < found_cost)
+            {
+                found = t;
+                found_cost = track.best;
+                spot.start = track.best_start;
+                spot.end = track.best_end;
+            }
+
+            // a full path is a candidate, kept while nothing overlapping beats it
+            uint32_t last = track.cost[SAMPLES - 1];
+            if (last <= ACCEPT_COST && last < track.best)
+            {
+                track.best = last;
+                track.best_start = track.start[SAMPLES - 1];
+                track.best_end = position;
+            }
+        }
+        cells += count * SAMPLES;
+        box = {{0, 0, 0}, 0, position};
+    }
+
+    counters.samples++;
+    counters.cells += cells;
+    counters.peak_cells = cells > counters.peak_cells ? cells : counters.peak_cells;
+
+    if (found < 0)
+    {
+        return false;
+    }
+    // one report per motion: whatever else overlaps it is the same gesture
+    suppress(spot.end);
+    spot.id = ids[found];
+    spot.similarity = dtw_cost_similarity(found_cost);
+    return true;
+}
+
+GestureSpotter::Stats GestureSpotter::stats() const
+{
+    return counters;
+}
@@ -0,0 +1,96 @@
+#ifndef GESTURE_SPOTTER_HPP
+#define GESTURE_SPOTTER_HPP
+
+#include <cstdint>
+
+#include "dtw.hpp"
+#include "gyroscope.hpp"
+
+// Always-on gesture spotting: finds enrolled gestures anywhere in the live,
+// conditioned sample stream, without a button press to say where one
+// starts. Each template is matched with SPRING (Sakurai, Faloutsos and
+// Yamamuro, "Stream Monitoring under the Time Warping Distance", 2007): a
+// DTW column per template where every cell also remembers the stream
+// position its best path started from, so a match may begin at any sample.
+// A match is reported once no path still running can beat it.
+//
+// Templates are SAMPLES points box-filtered from gestures of any length, so
+// the stream is box-filtered the same way at several STEPS, one per gesture
+// duration the spotter covers; DTW absorbs the speeds in between. Every
+// template and step keeps one column of SAMPLES cells, so the memory is fixed
+// and a new sample costs at most MAX_TEMPLATES * SCALES * SAMPLES cells, and
+// most samples far less since each scale only advances once per step.
+class GestureSpotter
+{
+public:
+    static const int MAX_TEMPLATES = 8;
+    static const int SCALES = 6;
+    static const int STEPS[SCALES]; // stream samples per template point
+
+    // the cost a spot must stay under, the unlock path's DTW accept limit
+    static const uint32_t ACCEPT_COST = DTW_ACCEPT_LIMIT;
+
+    struct Spot
+    {
+        int id;
+        int32_t similarity; // Q15, like dtw_similarity()
+        uint32_t start;     // stream samples since reset(), end exclusive
+        uint32_t end;
+    };
+
+    struct Stats
+    {
+        uint32_t samples;     // pushed since construction
+        uint64_t cells;       // DTW cells updated for them
+        uint32_t peak_cells;  // most cells a single sample cost
+    };
+
+    GestureSpotter();
+
+    // forgets the stream, keeps the templates
+    void reset();
+
+    // adds a template, or replaces the one with the same id; false when full
+    bool add(int id, const Gesture &gesture);
+
+    // feeds one conditioned sample; true with `spot` filled in when a match
+    // became final
+    bool push(const GyroData &sample, Spot &spot);
+
+    Stats stats() const;
+
+private:
+    // one template followed at one scale
+    struct Track
+    {
+        uint32_t cost[SAMPLES];  // the latest column, Q22
+        uint32_t start[SAMPLES]; // stream position each cell's path began at
+        uint32_t best;           // cost of the pending match, DTW_INFINITY if none
+        uint32_t best_start;
+        uint32_t best_end;
+    };
+
+    // the stream box-filtered at one scale
+    struct Box
+    {
+        int32_t sums[3];
+        int count;
+        uint32_t start; // stream position of the box's first sample
+    };
+
+    int ids[MAX_TEMPLATES];
+    Gesture templates[MAX_TEMPLATES];
+    int count = 0;
+
+    Track tracks[MAX_TEMPLATES][SCALES];
+    Box boxes[SCALES];
+    uint32_t position = 0; // stream samples since reset()
+    Stats counters = {};
+
+    void clear(Track &track);
+    void step(Track &track, const Gesture &gesture, const int32_t point[3], uint32_t start);
+    bool final(const Track &track) const;
+    void suppress(uint32_t end); // drops every pending match and path starting before `end`
+};
+
+#endif // GESTURE_SPOTTER_HPP
@@ -1,72 +1,97 @@
 #include "gyroscope.hpp"
 
-EventFlags flags;
+#include <cstdio>
+#include <cstring>
 
-SPI spi(PF_9, PF_8, PF_7, PC_1, use_gpio_ssel);
+#include "bias_estimator.hpp"
+#include "hal.hpp"
+#include "profiler.hpp"
 
-float Gyroscope::x_bias = 0.0f;
-float Gyroscope::y_bias = 0.0f;
-float Gyroscope::z_bias = 0.0f;
+template <class Config>
+float Gyroscope<Config>::x_bias = 0.0f;
+template <class Config>
+float Gyroscope<Config>::y_bias = 0.0f;
+template <class Config>
+float Gyroscope<Config>::z_bias = 0.0f;
 
-bool Gyroscope::init()
+template <class Config>
+Gyroscope<Config>::Gyroscope(SpiBus &bus) : spi(bus)
 {
-    // SPI:
-    // - 8-bit data size
-    // - Mode 3 (CPOL = 1, CPHA = 1): idle clock high, data sampled on falling edge
-    spi.format(8, 3);
+}
 
-    // Set SPI communication frequency to 1 MHz
-    spi.frequency(1'000'000);
+template <class Config>
+bool Gyroscope<Config>::init()
+{
+    const uint8_t config[CTRL_REG_COUNT] = {
+        Config::CTRL_REG1, Config::CTRL_REG2, Config::CTRL_REG3, Config::CTRL_REG4, Config::CTRL_REG5};
 
-    set_register(spi, CTRL_REG1, CTRL_REG1_CONFIG);
-    set_register(spi, CTRL_REG2, CTRL_REG2_CONFIG);
-    set_register(spi, CTRL_REG4, CTRL_REG4_CONFIG);
-    set_register(spi, CTRL_REG5, CTRL_REG5_CONFIG);
+    uint8_t write_buf[1 + CTRL_REG_COUNT];
+    uint8_t read_buf[1 + CTRL_REG_COUNT];
 
-    return true;
+    write_buf[0] = CTRL_REG1 | AUTO_INCREMENT;
+    memcpy(&write_buf[1], config, CTRL_REG_COUNT);
+    spi.transfer(write_buf, read_buf, 1 + CTRL_REG_COUNT);
+
+    // L3GD20, L3GD20H and I3G4250D share the register map
+    uint8_t id = read_register(WHO_AM_I);
+    if (id != 0xD4 && id != 0xD7 && id != 0xD3)
+    {
+        return false;
+    }
+
+    write_buf[0] = CTRL_REG1 | READ | AUTO_INCREMENT;
+    memset(&write_buf[1], 0, CTRL_REG_COUNT);
+    spi.transfer(write_buf, read_buf, 1 + CTRL_REG_COUNT);
+
+    return memcmp(&read_buf[1], config, CTRL_REG_COUNT) == 0;
 }
 
-void Gyroscope::spi_cb(int event)
+template <class Config>
+void Gyroscope<Config>::set_register(uint8_t reg, uint8_t value)
 {
-    flags.set(SPI_FLAG); // Set the SPI_FLAG to signal that transfer is complete
+    uint8_t write_buf[2] = {reg, value};
+    uint8_t read_buf[2];
+    spi.transfer(write_buf, read_buf, 2);
 }
 
-void Gyroscope::set_register(SPI &spi, uint8_t reg, uint8_t value)
+template <class Config>
+void Gyroscope<Config>::set_power(GyroPower mode)
 {
-    static uint8_t write_buf[32];
-    static uint8_t read_buf[32];
+    uint8_t reg1 = Config::CTRL_REG1;
+    if (mode == GYRO_SLEEP)
+    {
+        reg1 &= ~CTRL_REG1_AXES; // PD set with every axis off is sleep
+    }
+    else if (mode == GYRO_POWER_DOWN)
+    {
+        reg1 &= ~CTRL_REG1_PD;
+    }
+    set_register(CTRL_REG1, reg1);
+}
 
-    write_buf[0] = reg;
-    write_buf[1] = value;
-    spi.transfer(write_buf, 2, read_buf, 2, callback(this, &Gyroscope::spi_cb)); // Initiate SPI transfer
-    flags.wait_all(SPI_FLAG);                                                    // Wait until the transfer completes
+template <class Config>
+uint8_t Gyroscope<Config>::read_register(uint8_t reg)
+{
+    uint8_t write_buf[2] = {(uint8_t)(reg | READ), 0};
+    uint8_t read_buf[2];
+    spi.transfer(write_buf, read_buf, 2);
+    return read_buf[1];
 }
 
-Gyroscope::GyroData Gyroscope::read_gyro()
+template <class Config>
+GyroData Gyroscope<Config>::decode(const uint8_t *bytes)
 {
-    static uint8_t write_buf[32];
-    static uint8_t read_buf[32];
     GyroData data;
 
-    // Prepare to read gyroscope output starting at OUT_X_L
-    // - write_buf[0]: register address with read (0x80) and auto-increment (0x40) bits set
-    write_buf[0] = OUT_X_L | 0x80 | 0x40; // Read mode + auto-increment
-
-    // Perform SPI transfer to read 6 bytes (X, Y, Z axis data)
-    // - write_buf[1:6] contains dummy data for clocking
-    // - read_buf[1:6] will store received data
-    spi.transfer(write_buf, 7, read_buf, 7, callback(this, &Gyroscope::spi_cb));
-    flags.wait_all(SPI_FLAG); // Wait until the transfer completes
-
     // --- Extract and Convert Raw Data ---
     // Combine high and low bytes for X-axis
-    data.x_raw = (int16_t)(((read_buf[2]) << 8) | read_buf[1]);
+    data.x_raw = (int16_t)(((bytes[1]) << 8) | bytes[0]);
 
     // Combine high and low bytes for Y-axis
-    data.y_raw = (int16_t)(((read_buf[4]) << 8) | read_buf[3]);
+    data.y_raw = (int16_t)(((bytes[3]) << 8) | bytes[2]);
 
     // Combine high and low bytes for Z-axis
-    data.z_raw = (int16_t)(((read_buf[6]) << 8) | read_buf[5]);
+    data.z_raw = (int16_t)(((bytes[5]) << 8) | bytes[4]);
 
     if (calibrated)
     {
@@ -75,46 +100,224 @@ Gyroscope::GyroData Gyroscope::read_gyro()
         data.z_raw -= z_bias;
     }
 
-    data.x_dps = (float)data.x_raw * SENSITIVITY;
-    data.y_dps = (float)data.y_raw * SENSITIVITY;
-    data.z_dps = (float)data.z_raw * SENSITIVITY;
+    data.x_dps = (float)data.x_raw * Config::SENSITIVITY;
+    data.y_dps = (float)data.y_raw * Config::SENSITIVITY;
+    data.z_dps = (float)data.z_raw * Config::SENSITIVITY;
+
+    return data;
+}
+
+template <class Config>
+GyroData Gyroscope<Config>::read_gyro()
+{
+    uint8_t write_buf[1 + BYTES_PER_SAMPLE] = {};
+    uint8_t read_buf[1 + BYTES_PER_SAMPLE];
+
+    // Prepare to read gyroscope output starting at OUT_X_L
+    // - write_buf[0]: register address with read (0x80) and auto-increment (0x40) bits set
+    write_buf[0] = OUT_X_L | READ | AUTO_INCREMENT; // Read mode + auto-increment
+
+    // Perform SPI transfer to read 6 bytes (X, Y, Z axis data)
+    // - write_buf[1:6] contains dummy data for clocking
+    // - read_buf[1:6] will store received data
+    spi.transfer(write_buf, read_buf, 1 + BYTES_PER_SAMPLE);
 
-    // printf("X(dps): %.5f, Y(dps): %.5f, Z(dps): %.5f\n", data.x_dps, data.y_dps, data.z_dps);
-    printf("x (raw): %d, y (raw): %d, z (raw): %d\n", data.x_raw, data.y_raw, data.z_raw);
-    // printf(">x_axis(raw): %d\n", data.x_raw);
-    // printf(">y_axis(raw): %d\n", data.y_raw);
-    // printf(">z_axis(raw): %d\n", data.z_raw);
+    GyroData data = decode(&read_buf[1]);
 
     return data;
 }
 
-void Gyroscope::calibrate()
+template <class Config>
+bool Gyroscope<Config>::enable_fifo(uint8_t watermark)
+{
+    if (watermark == 0 || watermark >= FIFO_DEPTH)
+    {
+        return false;
+    }
+
+    // route the watermark flag to INT2 so the host only wakes up once per batch
+    set_register(CTRL_REG3, CTRL_REG3_I2_WTM);
+    set_register(FIFO_CTRL_REG, (FIFO_MODE_STREAM << 5) | watermark);
+    set_register(CTRL_REG5, Config::CTRL_REG5 | CTRL_REG5_FIFO_EN);
+
+    return true;
+}
+
+template <class Config>
+void Gyroscope<Config>::disable_fifo()
+{
+    set_register(CTRL_REG5, Config::CTRL_REG5);
+    set_register(FIFO_CTRL_REG, FIFO_MODE_BYPASS << 5);
+    set_register(CTRL_REG3, 0);
+}
+
+template <class Config>
+size_t Gyroscope<Config>::fifo_samples(uint8_t src)
+{
+    fifo_overrun = (src & FIFO_SRC_OVRN) != 0;
+
+    // FSS only has five bits, a full FIFO is reported through OVRN
+    return fifo_overrun ? FIFO_DEPTH : (src & FIFO_SRC_FSS);
+}
+
+template <class Config>
+uint8_t Gyroscope<Config>::fifo_level()
 {
-    const int numSamples = 200;
-    int16_t xReadings[numSamples], yReadings[numSamples], zReadings[numSamples];
-    float xSum = 0.0, ySum = 0.0, zSum = 0.0;
+    return (uint8_t)fifo_samples(read_register(FIFO_SRC_REG));
+}
+
+template <class Config>
+void Gyroscope<Config>::prepare_burst(size_t count)
+{
+    // With the FIFO enabled the address pointer wraps from OUT_Z_H back to
+    // OUT_X_L, so every queued sample comes out of one long read.
+    fifo_count = count;
+    fifo_burst.len = 1 + count * BYTES_PER_SAMPLE;
+    fifo_burst.tx_buf[0] = OUT_X_L | READ | AUTO_INCREMENT;
+    memset(&fifo_burst.tx_buf[1], 0, fifo_burst.len - 1);
+}
+
+template <class Config>
+void Gyroscope<Config>::decode_burst(GyroData *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = decode(&fifo_burst.rx_buf[1 + i * BYTES_PER_SAMPLE]);
+    }
+}
+
+template <class Config>
+size_t Gyroscope<Config>::read_fifo(GyroData *out, size_t capacity)
+{
+    size_t count = fifo_level();
+    if (count > capacity)
+    {
+        count = capacity;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    prepare_burst(count);
+    {
+        PROFILE_SCOPE(PROF_SPI_BURST);
+        spi.transfer(fifo_burst.tx_buf, fifo_burst.rx_buf, fifo_burst.len);
+    }
+    decode_burst(out, count);
+
+    return count;
+}
+
+template <class Config>
+void Gyroscope<Config>::read_fifo_async(SpiCallback done, void *context)
+{
+    fifo_done = done;
+    fifo_context = context;
+    fifo_count = 0;
+
+    fifo_status.tx_buf[0] = FIFO_SRC_REG | READ;
+    fifo_status.tx_buf[1] = 0;
+    fifo_status.done = on_fifo_status;
+    fifo_status.context = this;
+    spi.submit(fifo_status);
+}
 
-    // Collect samples
-    for (int i = 0; i < numSamples; ++i)
+template <class Config>
+void Gyroscope<Config>::on_fifo_status(void *gyro)
+{
+    Gyroscope &self = *static_cast<Gyroscope *>(gyro);
+
+    // a failed status read says nothing about the level; try again next time
+    size_t count = self.fifo_status.failed ? 0 : self.fifo_samples(self.fifo_status.rx_buf[1]);
+    if (count == 0)
+    {
+        if (self.fifo_done)
+        {
+            self.fifo_done(self.fifo_context);
+        }
+        return;
+    }
+
+    // timed from here to fifo_result(), so it includes handing the batch over
+    PROFILE_START(PROF_SPI_BURST);
+    self.prepare_burst(count);
+    self.fifo_burst.done = self.fifo_done;
+    self.fifo_burst.context = self.fifo_context;
+    self.spi.submit(self.fifo_burst);
+}
+
+template <class Config>
+size_t Gyroscope<Config>::fifo_result(GyroData *out, size_t capacity)
+{
+    if (fifo_count > 0)
+    {
+        PROFILE_STOP(PROF_SPI_BURST);
+    }
+
+    // the samples of a failed burst are gone from the FIFO, as after an overrun
+    size_t available = fifo_burst.failed ? 0 : fifo_count;
+    size_t count = available < capacity ? available : capacity;
+    if (count > 0)
+    {
+        decode_burst(out, count);
+    }
+    return count;
+}
+
+template <class Config>
+bool Gyroscope<Config>::calibrate(uint32_t timeout_ms)
+{
+    BiasEstimator estimator;
+    GyroData batch[FIFO_DEPTH];
+
+    // estimate on raw counts
+    bool was_calibrated = calibrated;
+    calibrated = false;
+
+    bool converged = false;
+    if (enable_fifo(CALIBRATION_WATERMARK))
     {
-        xReadings[i] = read_gyro().x_raw;
-        yReadings[i] = read_gyro().y_raw;
-        zReadings[i] = read_gyro().z_raw;
-
-        xSum += xReadings[i];
-        ySum += yReadings[i];
-        zSum += zReadings[i];
-        thread_sleep_for(1);
+        uint32_t start = hal_now_ms();
+        while (!converged && hal_now_ms() - start < timeout_ms)
+        {
+            hal_sleep_ms(CALIBRATION_POLL_MS);
+            size_t count = read_fifo(batch, FIFO_DEPTH);
+            for (size_t i = 0; i < count && !converged; ++i)
+            {
+                estimator.add(batch[i].x_raw, batch[i].y_raw, batch[i].z_raw);
+                if (!estimator.stationary())
+                {
+                    estimator.reset(); // moved: start over
+                }
+                converged = estimator.converged();
+            }
+        }
+        disable_fifo();
     }
 
-    Gyroscope::x_bias = xSum / numSamples;
-    Gyroscope::y_bias = ySum / numSamples;
-    Gyroscope::z_bias = zSum / numSamples;
+    calibrated = was_calibrated;
+    if (converged)
+    {
+        set_bias(estimator.mean(0), estimator.mean(1), estimator.mean(2));
+    }
+    return converged;
+}
 
+template <class Config>
+void Gyroscope<Config>::set_bias(float x, float y, float z)
+{
+    x_bias = x;
+    y_bias = y;
+    z_bias = z;
     calibrated = true;
 }
 
-bool Gyroscope::is_calibrated()
+template <class Config>
+bool Gyroscope<Config>::is_calibrated()
 {
     return calibrated;
-}
\ No newline at end of file
+}
+
+// the configuration the application is built with; add a line for any other
+template class Gyroscope<GyroConfig>;
@@ -1,57 +1,244 @@
 #ifndef GYROSCOPE_HPP
 #define GYROSCOPE_HPP
 
-#include "mbed.h"
+#include <cstddef>
+#include <cstdint>
 
+#include "spi_bus.hpp"
+
+// Output data rate, the CTRL_REG1 DR field
+enum GyroOdr
+{
+    GYRO_ODR_100HZ = 0b00,
+    GYRO_ODR_200HZ = 0b01,
+    GYRO_ODR_400HZ = 0b10,
+    GYRO_ODR_800HZ = 0b11
+};
+
+// Full-scale range, the CTRL_REG4 FS field
+enum GyroRange
+{
+    GYRO_RANGE_245DPS = 0b00,
+    GYRO_RANGE_500DPS = 0b01,
+    GYRO_RANGE_2000DPS = 0b10
+};
+
+// High-pass filter mode, the CTRL_REG2 HPM field plus CTRL_REG5 HPen
+enum GyroHpf
+{
+    GYRO_HPF_OFF,
+    GYRO_HPF_NORMAL,    // reset by reading REFERENCE
+    GYRO_HPF_REFERENCE, // output relative to REFERENCE
+    GYRO_HPF_AUTORESET  // reset on interrupt events
+};
+
+// Power mode, the CTRL_REG1 PD bit plus the axis enables
+enum GyroPower
+{
+    GYRO_POWER_DOWN, // ~5 uA, 250 ms turn-on
+    GYRO_SLEEP,      // ~2 mA, axes off but the clock runs so it turns on within a few samples
+    GYRO_NORMAL      // ~6 mA, full-rate output
+};
+
+namespace l3gd20
+{
+
+// HPF cut-off in mHz: code HPCF at a given ODR is entry HPCF + 3 - DR
+constexpr uint32_t HPF_CUTOFFS_MHZ[] = {56000, 30000, 15000, 8000, 4000, 2000, 1000, 500, 200, 100, 50, 20, 10};
+constexpr int HPCF_CODES = 10;
+
+constexpr uint32_t odr_hz(GyroOdr odr)
+{
+    return 100u << odr;
+}
+
+// HPCF code giving exactly `cutoff_mhz` at `odr`, or -1 if there is none
+constexpr int hpcf(GyroOdr odr, uint32_t cutoff_mhz)
+{
+    for (int code = 0; code < HPCF_CODES; ++code)
+    {
+        if (HPF_CUTOFFS_MHZ[code + 3 - odr] == cutoff_mhz)
+        {
+            return code;
+        }
+    }
+    return -1;
+}
+
+constexpr uint8_t hpm(GyroHpf hpf)
+{
+    return hpf == GYRO_HPF_REFERENCE ? 0b01 : hpf == GYRO_HPF_AUTORESET ? 0b11 : 0b00;
+}
+
+// micro-dps per LSB
+constexpr uint32_t sensitivity_udps(GyroRange range)
+{
+    return range == GYRO_RANGE_245DPS ? 8750 : range == GYRO_RANGE_500DPS ? 17500 : 70000;
+}
+
+} // namespace l3gd20
+
+// Everything the sensor is configured with, fixed at compile time. The
+// CTRL_REG1..5 values and the count to dps factor are derived here so they
+// can never disagree. The HPF only reaches the data registers and the FIFO
+// when `HpfOnOutput` is set: bias calibration needs to see the DC offset.
+template <GyroOdr Odr, GyroRange Range, GyroHpf Hpf = GYRO_HPF_OFF, uint32_t HpfCutoffMhz = 0, bool HpfOnOutput = false>
+struct L3gd20Config
+{
+    static_assert(Odr >= GYRO_ODR_100HZ && Odr <= GYRO_ODR_800HZ, "unsupported ODR");
+    static_assert(Range >= GYRO_RANGE_245DPS && Range <= GYRO_RANGE_2000DPS, "unsupported full-scale range");
+    static_assert(Hpf != GYRO_HPF_OFF || (HpfCutoffMhz == 0 && !HpfOnOutput), "cut-off or HPF output set with the HPF off");
+    static_assert(Hpf == GYRO_HPF_OFF || l3gd20::hpcf(Odr, HpfCutoffMhz) >= 0, "HPF cut-off not available at this ODR");
+
+    static constexpr uint32_t ODR_HZ = l3gd20::odr_hz(Odr);
+
+    static constexpr uint8_t CTRL_REG1 = (uint8_t)(Odr << 6 | 0b1111); // narrowest bandwidth, powered, XYZ enabled
+    static constexpr uint8_t CTRL_REG2 = (uint8_t)(Hpf == GYRO_HPF_OFF ? 0 : l3gd20::hpm(Hpf) << 4 | l3gd20::hpcf(Odr, HpfCutoffMhz));
+    static constexpr uint8_t CTRL_REG3 = 0; // interrupts are routed by enable_fifo()
+    static constexpr uint8_t CTRL_REG4 = (uint8_t)(Range << 4);
+    static constexpr uint8_t CTRL_REG5 = (uint8_t)((Hpf == GYRO_HPF_OFF ? 0 : 0b00010000) | (HpfOnOutput ? 0b01 : 0b00));
+
+    static constexpr uint32_t SENSITIVITY_UDPS = l3gd20::sensitivity_udps(Range);
+    static constexpr float SENSITIVITY = SENSITIVITY_UDPS / 1000000.0f; // dps per count
+
+    // raw counts for a rate in mdps, for thresholds that follow the range
+    static constexpr int32_t counts(int32_t mdps)
+    {
+        return (int32_t)((int64_t)mdps * 1000 / SENSITIVITY_UDPS);
+    }
+};
+
+struct GyroData
+{
+    float x_dps, y_dps, z_dps;
+    int16_t x_raw, y_raw, z_raw;
+};
+
+// L3GD20 driver. Member functions live in gyroscope.cpp, which instantiates
+// the GyroConfig the application is built with.
+template <class Config>
 class Gyroscope
 {
 private:
+    static const uint8_t WHO_AM_I = 0x0F;
+
     static const uint8_t CTRL_REG1 = 0x20; // ODR and bandwidth settings
     static const uint8_t CTRL_REG2 = 0x21; // High-pass filter settings
-    static const uint8_t CTRL_REG4 = 0x23;
-    static const uint8_t CTRL_REG5 = 0x24; // High-pass filter enable
+    static const uint8_t CTRL_REG3 = 0x22; // Interrupt routing
+    static const uint8_t CTRL_REG4 = 0x23; // Full-scale range
+    static const uint8_t CTRL_REG5 = 0x24; // High-pass filter and FIFO enable
 
-    static const uint8_t CTRL_REG1_ODR = 0b0100; // ODR = 200 Hz, Cut-off = 12
+    static const int CTRL_REG_COUNT = 5;
 
-    static const uint8_t CTRL_REG1_CONFIG = (CTRL_REG1_ODR << 4) | 0b1111;
+    static const uint8_t CTRL_REG1_PD = 0b00001000;   // powered when set
+    static const uint8_t CTRL_REG1_AXES = 0b00000111; // Z, Y and X enable
 
-    static const uint8_t CTRL_REG2_HPM1 = 0b00;   // High-pass filter normal mode
-    static const uint8_t CTRL_REG2_HPCF = 0b0101; // High-pass filter cut-off. ODR = 200Hz, Cut-off = .5
+    static const uint8_t CTRL_REG3_I2_WTM = 0b00000100; // FIFO watermark on INT2 (DRDY pin)
+    static const uint8_t CTRL_REG5_FIFO_EN = 0b01000000;
 
-    static const uint8_t CTRL_REG2_CONFIG = (00 | CTRL_REG2_HPM1 << 4) | CTRL_REG2_HPCF;
+    static const uint8_t OUT_X_L = 0x28;
 
-    static const uint8_t CTRL_REG4_FS = 0b00; // resolution // +/- 245 dps. Must change sensitivity
-    static const uint8_t CTRL_REG4_CONFIG = (0 | CTRL_REG4_FS << 3) | 0b0000;
+    static const uint8_t FIFO_CTRL_REG = 0x2E;
+    static const uint8_t FIFO_SRC_REG = 0x2F;
 
-    static const uint8_t CTRL_REG5_CONFIG = 0b00010000; // Enable high-pass filter
+    static const uint8_t FIFO_MODE_BYPASS = 0b000;
+    static const uint8_t FIFO_MODE_STREAM = 0b010;
 
-    static constexpr float SENSITIVITY = 8.75f / 1000.0f;
+    static const uint8_t FIFO_SRC_WTM = 0x80;  // level >= watermark
+    static const uint8_t FIFO_SRC_OVRN = 0x40; // oldest sample was overwritten
+    static const uint8_t FIFO_SRC_FSS = 0x1F;  // number of unread samples (32 reads as 31 + OVRN)
 
-    static const uint8_t OUT_X_L = 0x28;
+    static const uint8_t READ = 0x80;
+    static const uint8_t AUTO_INCREMENT = 0x40;
+
+    static const int BYTES_PER_SAMPLE = 6;
+
+    static const uint8_t CALIBRATION_WATERMARK = 4; // samples per FIFO read while calibrating
+    static const uint32_t CALIBRATION_POLL_MS = 5;
 
-    static const int SPI_FLAG = 1;
+    SpiBus &spi;
+
+    // The two halves of a FIFO drain, reused by every drain. Register
+    // accesses bring their own buffers on the stack, so they are safe from
+    // any thread.
+    SpiFrame<2> fifo_status;
+    SpiFrame<1 + 32 * BYTES_PER_SAMPLE> fifo_burst; // address byte plus a full FIFO
+    size_t fifo_count = 0; // samples fifo_burst holds
+    SpiCallback fifo_done = nullptr;
+    void *fifo_context = nullptr;
+
+    uint8_t read_register(uint8_t reg);
 
 public:
+    typedef ::GyroData GyroData;
+
+    static const int FIFO_DEPTH = 32;
+    static const uint32_t ODR_HZ = Config::ODR_HZ;
+
     static float x_bias, y_bias, z_bias;
 
     bool calibrated = false;
 
-    void spi_cb(int event);
+    // set when the last FIFO drain found the sensor had dropped samples
+    bool fifo_overrun = false;
+
+    explicit Gyroscope(SpiBus &bus);
 
+    // Writes CTRL_REG1..5 in one auto-increment burst, then checks WHO_AM_I
+    // and reads the registers back. False if the sensor is absent or did not
+    // take the configuration.
     bool init();
 
-    void set_register(SPI &spi, uint8_t reg, uint8_t value);
+    void set_register(uint8_t reg, uint8_t value);
+
+    // Switches the power mode, keeping the configured ODR and bandwidth.
+    // Only the output registers are valid while the FIFO is disabled.
+    void set_power(GyroPower mode);
+
+    // Streams samples into a BiasEstimator until the bias has converged with
+    // the board held still, restarting whenever it moves. Gives up after
+    // `timeout_ms` and keeps the previous bias. Must run before the sampler
+    // owns the FIFO.
+    bool calibrate(uint32_t timeout_ms);
 
-    void calibrate(); // Change return type to void
+    // adopt a bias from storage or from drift tracking, in raw counts
+    void set_bias(float x, float y, float z);
 
     bool is_calibrated();
-    struct GyroData
-    {
-        float x_dps, y_dps, z_dps;
-        int16_t x_raw, y_raw, z_raw;
-    };
 
     GyroData read_gyro();
+
+    // Stream mode: the sensor keeps the newest FIFO_DEPTH samples and raises
+    // INT2 once at least `watermark` of them are waiting.
+    bool enable_fifo(uint8_t watermark);
+    void disable_fifo();
+
+    uint8_t fifo_level();
+
+    // Drains up to `capacity` samples in a single auto-increment burst and
+    // returns how many were written to `out`, oldest first.
+    size_t read_fifo(GyroData *out, size_t capacity);
+
+    // The same drain without blocking: the FIFO_SRC_REG read completes
+    // straight into the burst for every waiting sample, and `done` runs in
+    // completion context once both are through (`done` may be null).
+    // fifo_result() then decodes the samples. Only the FIFO's owner drains
+    // it, one drain at a time.
+    void read_fifo_async(SpiCallback done, void *context);
+    size_t fifo_result(GyroData *out, size_t capacity);
+
+private:
+    GyroData decode(const uint8_t *bytes);
+
+    size_t fifo_samples(uint8_t src); // FIFO_SRC_REG to a sample count, updates fifo_overrun
+    void prepare_burst(size_t count);
+    void decode_burst(GyroData *out, size_t count);
+
+    static void on_fifo_status(void *gyro);
 };
 
-#endif // GYROSCOPE_H
\ No newline at end of file
+// 200 Hz, +/-245 dps, 0.5 Hz high-pass kept off the data path
+typedef L3gd20Config<GYRO_ODR_200HZ, GYRO_RANGE_245DPS, GYRO_HPF_NORMAL, 500> GyroConfig;
+typedef Gyroscope<GyroConfig> Gyro;
+
+#endif // GYROSCOPE_H
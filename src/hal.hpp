@@ -0,0 +1,145 @@
+#ifndef HAL_HPP
+#define HAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Thin seam over the board services the application uses, so the same
+// record/unlock code runs on the DISCO-F429ZI (mbed_hal.cpp) and in the host
+// simulation (host_hal.cpp). The display and touch interfaces mirror the BSP
+// method names so call sites read the same as before.
+
+constexpr uint32_t COLOR_BLUE = 0xFF0000FF;
+constexpr uint32_t COLOR_GREEN = 0xFF00FF00;
+constexpr uint32_t COLOR_RED = 0xFFFF0000;
+constexpr uint32_t COLOR_WHITE = 0xFFFFFFFF;
+constexpr uint32_t COLOR_BLACK = 0xFF000000;
+
+enum FontSize
+{
+    FONT_8,
+    FONT_16,
+    FONT_20,
+};
+
+enum TextAlign
+{
+    ALIGN_CENTER,
+    ALIGN_RIGHT,
+    ALIGN_LEFT,
+};
+
+struct Rect
+{
+    uint16_t x, y, width, height;
+};
+
+// rows top..bottom of one strip chart column, inclusive, in `color`
+struct PlotSpan
+{
+    uint16_t top, bottom;
+    uint32_t color;
+};
+
+class Display
+{
+public:
+    virtual ~Display() = default;
+
+    virtual uint16_t GetXSize() = 0;
+    virtual uint16_t GetYSize() = 0;
+
+    virtual void Clear(uint32_t color) = 0;
+    virtual void SetBackColor(uint32_t color) = 0;
+    virtual void SetTextColor(uint32_t color) = 0;
+    virtual void SetFont(FontSize font) = 0;
+
+    // y coordinate of a text line in the current font, like the BSP LINE()
+    virtual uint16_t Line(uint16_t line) = 0;
+    virtual uint16_t CharWidth() = 0;
+
+    virtual void DisplayStringAt(uint16_t x, uint16_t y, const char *text, TextAlign align) = 0;
+
+    // Draws `length` characters of `text` from (x, y) in the current font,
+    // every cell painted whole in the text and back colours, as one run.
+    // Cheap enough to redraw just the characters of a readout that changed.
+    virtual void DrawText(uint16_t x, uint16_t y, const char *text, size_t length) = 0;
+    virtual void DisplayStringAtLine(uint16_t line, const char *text) = 0;
+    virtual void ClearStringLine(uint32_t line) = 0;
+
+    virtual void FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) = 0;
+    virtual void DrawRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) = 0;
+
+    // Drawing goes to a back buffer; Present() makes it visible at the next
+    // vertical blank. `changed` lists the areas drawn since the last call
+    // (nullptr means the whole screen) so both buffers can be kept in sync
+    // without copying full frames.
+    virtual void Present(const Rect *changed, int count) = 0;
+
+    // A strip chart on a layer of its own, laid over `area` of the screen
+    // and unaffected by drawing and Present(). PlotBegin() starts it empty
+    // in `background`; each PlotColumn() adds one column at the right edge,
+    // drawn from `spans` in order, and scrolls the rest left by moving the
+    // layer's start address, so no earlier column is copied or redrawn.
+    virtual void PlotBegin(Rect area, uint32_t background) = 0;
+    virtual void PlotColumn(const PlotSpan *spans, int count) = 0;
+    virtual void PlotShow(bool visible) = 0;
+
+    // Panel and backlight power. The frame buffers and the chart are not
+    // kept while the display is off: repaint everything before turning it
+    // back on.
+    virtual void DisplayOn() = 0;
+    virtual void DisplayOff() = 0;
+};
+
+typedef void (*EventHandler)(void *context);
+
+struct TouchState
+{
+    bool touched;
+    uint16_t x, y;
+};
+
+class Touch
+{
+public:
+    virtual ~Touch() = default;
+
+    virtual bool Init(uint16_t width, uint16_t height) = 0;
+    virtual void GetState(TouchState *state) = 0;
+
+    // Calls `handler` from interrupt context whenever the controller sees a
+    // finger arrive or leave. False if the panel has no interrupt line.
+    virtual bool AttachInterrupt(EventHandler handler, void *context) = 0;
+
+    // acknowledges the controller so its interrupt line can fire again
+    virtual void ClearInterrupt() = 0;
+};
+
+// Deferred work for the UI thread, shaped after mbed's EventQueue: handlers
+// run one at a time on whichever thread dispatches, so they never need locks
+// against each other.
+class EventLoop
+{
+public:
+    virtual ~EventLoop() = default;
+
+    // both return an id for cancel(), never 0
+    virtual int call_in(uint32_t ms, EventHandler handler, void *context) = 0;
+    virtual int call_every(uint32_t ms, EventHandler handler, void *context) = 0;
+    virtual void cancel(int id) = 0;
+
+    // runs handlers as they come due for `ms` milliseconds
+    virtual void dispatch_for(uint32_t ms) = 0;
+};
+
+void hal_sleep_ms(uint32_t ms);
+
+uint32_t hal_now_ms();
+
+// Lets the MCU enter deep sleep (STOP) whenever every thread is blocked.
+// Only EXTI lines and the low-power ticker wake it, so keep this off while
+// peripherals that need the main clocks are running.
+void hal_allow_deep_sleep(bool allowed);
+
+#endif // HAL_HPP
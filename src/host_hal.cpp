@@ -0,0 +1,272 @@
+#include "host_hal.hpp"
+
+#include <cstdio>
+
+static uint32_t virtual_ms = 0;
+static HostTickHook tick_hook = nullptr;
+static void *tick_context = nullptr;
+static bool deep_sleep_allowed = false;
+
+void host_set_tick_hook(HostTickHook hook, void *context)
+{
+    tick_hook = hook;
+    tick_context = context;
+}
+
+void hal_sleep_ms(uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms; ++i)
+    {
+        virtual_ms++;
+        if (tick_hook)
+        {
+            tick_hook(virtual_ms, tick_context);
+        }
+    }
+}
+
+uint32_t hal_now_ms()
+{
+    return virtual_ms;
+}
+
+void hal_allow_deep_sleep(bool allowed)
+{
+    deep_sleep_allowed = allowed;
+}
+
+bool host_deep_sleep_allowed()
+{
+    return deep_sleep_allowed;
+}
+
+uint16_t HostDisplay::GetXSize()
+{
+    return 240;
+}
+
+uint16_t HostDisplay::GetYSize()
+{
+    return 320;
+}
+
+void HostDisplay::Clear(uint32_t color)
+{
+    counters.clears++;
+    counters.pixels_filled += (uint32_t)GetXSize() * GetYSize();
+}
+
+void HostDisplay::SetBackColor(uint32_t color)
+{
+}
+
+void HostDisplay::SetTextColor(uint32_t color)
+{
+}
+
+void HostDisplay::SetFont(FontSize font)
+{
+    this->font = font;
+}
+
+uint16_t HostDisplay::Line(uint16_t line)
+{
+    // Font8, Font16 and Font20 are 8, 16 and 20 pixels high
+    static const uint16_t heights[] = {8, 16, 20};
+    return line * heights[font];
+}
+
+uint16_t HostDisplay::CharWidth()
+{
+    static const uint16_t widths[] = {5, 11, 14};
+    return widths[font];
+}
+
+void HostDisplay::DisplayStringAt(uint16_t x, uint16_t y, const char *text, TextAlign align)
+{
+    counters.strings++;
+    if (verbose)
+    {
+        printf("[lcd %3u,%3u] %s\n", x, y, text);
+    }
+}
+
+void HostDisplay::DrawText(uint16_t x, uint16_t y, const char *text, size_t length)
+{
+    counters.runs++;
+    counters.glyphs += (uint32_t)length;
+    counters.pixels_filled += (uint32_t)length * CharWidth() * Line(1);
+    if (verbose)
+    {
+        printf("[lcd %3u,%3u] %.*s\n", x, y, (int)length, text);
+    }
+}
+
+void HostDisplay::DisplayStringAtLine(uint16_t line, const char *text)
+{
+    DisplayStringAt(0, Line(line), text, ALIGN_LEFT);
+}
+
+void HostDisplay::ClearStringLine(uint32_t line)
+{
+    FillRect(0, Line(line), GetXSize(), Line(1));
+}
+
+void HostDisplay::FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    counters.rects++;
+    counters.pixels_filled += (uint32_t)width * height;
+}
+
+void HostDisplay::DrawRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    counters.rects++;
+}
+
+void HostDisplay::Present(const Rect *changed, int count)
+{
+    counters.frames++;
+    if (changed == nullptr)
+    {
+        counters.pixels_synced += (uint32_t)GetXSize() * GetYSize();
+        return;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        counters.pixels_synced += (uint32_t)changed[i].width * changed[i].height;
+    }
+}
+
+void HostDisplay::PlotBegin(Rect area, uint32_t background)
+{
+    plot_height = area.height;
+    // both copies of every column, like the board's ring
+    counters.pixels_filled += 2u * area.width * area.height;
+}
+
+void HostDisplay::PlotColumn(const PlotSpan *spans, int count)
+{
+    counters.plot_columns++;
+    counters.plot_pixels += 2u * plot_height;
+}
+
+void HostDisplay::PlotShow(bool visible)
+{
+    plot_shown = visible;
+}
+
+void HostDisplay::DisplayOn()
+{
+    on = true;
+}
+
+void HostDisplay::DisplayOff()
+{
+    on = false;
+}
+
+void HostTouch::set(bool touched, uint16_t x, uint16_t y)
+{
+    bool contact_changed = touched != state.touched;
+    state.touched = touched;
+    state.x = x;
+    state.y = y;
+    if (contact_changed && handler)
+    {
+        handler(context);
+    }
+}
+
+bool HostTouch::Init(uint16_t width, uint16_t height)
+{
+    return true;
+}
+
+void HostTouch::GetState(TouchState *out)
+{
+    reads++;
+    *out = state;
+}
+
+bool HostTouch::AttachInterrupt(EventHandler irq_handler, void *irq_context)
+{
+    handler = irq_handler;
+    context = irq_context;
+    return true;
+}
+
+void HostTouch::ClearInterrupt()
+{
+}
+
+int HostEventLoop::post(uint32_t ms, uint32_t period_ms, EventHandler handler, void *context)
+{
+    int id = next_id++;
+    events.push_back({id, hal_now_ms() + ms, period_ms, handler, context});
+    return id;
+}
+
+int HostEventLoop::call_in(uint32_t ms, EventHandler handler, void *context)
+{
+    return post(ms, 0, handler, context);
+}
+
+int HostEventLoop::call_every(uint32_t ms, EventHandler handler, void *context)
+{
+    return post(ms, ms, handler, context);
+}
+
+void HostEventLoop::cancel(int id)
+{
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        if (events[i].id == id)
+        {
+            events.erase(events.begin() + i);
+            return;
+        }
+    }
+}
+
+void HostEventLoop::dispatch_for(uint32_t ms)
+{
+    uint32_t end = hal_now_ms() + ms;
+
+    while (true)
+    {
+        // earliest due event, ties in posting order like the mbed queue
+        size_t next = events.size();
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            if (next == events.size() || (int32_t)(events[i].due_ms - events[next].due_ms) < 0)
+            {
+                next = i;
+            }
+        }
+        if (next == events.size() || (int32_t)(events[next].due_ms - end) > 0)
+        {
+            break;
+        }
+
+        Event event = events[next];
+        if ((int32_t)(event.due_ms - hal_now_ms()) > 0)
+        {
+            hal_sleep_ms(event.due_ms - hal_now_ms());
+        }
+        if (event.period_ms > 0)
+        {
+            events[next].due_ms += event.period_ms;
+        }
+        else
+        {
+            events.erase(events.begin() + next);
+        }
+        // the handler may post or cancel events, including this one
+        event.handler(event.context);
+    }
+
+    if ((int32_t)(end - hal_now_ms()) > 0)
+    {
+        hal_sleep_ms(end - hal_now_ms());
+    }
+}
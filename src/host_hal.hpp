@@ -0,0 +1,125 @@
+#ifndef HOST_HAL_HPP
+#define HOST_HAL_HPP
+
+#include <vector>
+
+#include "hal.hpp"
+
+// Host side of the HAL. Time is virtual: hal_sleep_ms() advances the clock
+// instantly and lets the simulation produce whatever sensor data and touches
+// would have happened meanwhile, so replays run much faster than real time.
+
+// called every millisecond of virtual time with the new clock value
+typedef void (*HostTickHook)(uint32_t now_ms, void *context);
+
+void host_set_tick_hook(HostTickHook hook, void *context);
+
+// what hal_allow_deep_sleep() last asked for, for the energy model
+bool host_deep_sleep_allowed();
+
+// headless display that only counts what would have been drawn
+class HostDisplay : public Display
+{
+private:
+    FontSize font = FONT_20;
+    uint16_t plot_height = 0;
+
+public:
+    struct Counters
+    {
+        uint32_t clears;
+        uint32_t strings;
+        uint32_t runs;   // DrawText() calls
+        uint32_t glyphs; // characters drawn by them
+        uint32_t rects;
+        uint64_t pixels_filled;
+        uint32_t frames;        // Present() calls
+        uint64_t pixels_synced; // copied back into the back buffer after a swap
+        uint32_t plot_columns;  // PlotColumn() calls
+        uint64_t plot_pixels;   // pixels written by them
+    };
+
+    Counters counters = {};
+
+    // echo every string to stdout, handy when debugging a trace
+    bool verbose = false;
+
+    bool on = true; // panel powered
+    bool plot_shown = false;
+
+    uint16_t GetXSize() override;
+    uint16_t GetYSize() override;
+
+    void Clear(uint32_t color) override;
+    void SetBackColor(uint32_t color) override;
+    void SetTextColor(uint32_t color) override;
+    void SetFont(FontSize font) override;
+    uint16_t Line(uint16_t line) override;
+    uint16_t CharWidth() override;
+
+    void DisplayStringAt(uint16_t x, uint16_t y, const char *text, TextAlign align) override;
+    void DrawText(uint16_t x, uint16_t y, const char *text, size_t length) override;
+    void DisplayStringAtLine(uint16_t line, const char *text) override;
+    void ClearStringLine(uint32_t line) override;
+
+    void FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) override;
+    void DrawRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) override;
+
+    void Present(const Rect *changed, int count) override;
+
+    void PlotBegin(Rect area, uint32_t background) override;
+    void PlotColumn(const PlotSpan *spans, int count) override;
+    void PlotShow(bool visible) override;
+
+    void DisplayOn() override;
+    void DisplayOff() override;
+};
+
+// touch panel driven by the replayed trace; like the STMPE811 it interrupts
+// whenever contact is made or lost
+class HostTouch : public Touch
+{
+private:
+    TouchState state = {};
+    EventHandler handler = nullptr;
+    void *context = nullptr;
+
+public:
+    // controller accesses, for comparing polled and interrupt-driven input
+    uint32_t reads = 0;
+
+    void set(bool touched, uint16_t x, uint16_t y);
+
+    bool Init(uint16_t width, uint16_t height) override;
+    void GetState(TouchState *state) override;
+    bool AttachInterrupt(EventHandler handler, void *context) override;
+    void ClearInterrupt() override;
+};
+
+// event queue on virtual time: dispatching sleeps straight to the next due
+// event, so the tick hook still sees every millisecond go by
+class HostEventLoop : public EventLoop
+{
+private:
+    struct Event
+    {
+        int id;
+        uint32_t due_ms;
+        uint32_t period_ms; // 0 for one-shot events
+        EventHandler handler;
+        void *context;
+    };
+
+    std::vector<Event> events;
+    int next_id = 1;
+
+    int post(uint32_t ms, uint32_t period_ms, EventHandler handler, void *context);
+
+public:
+    int call_in(uint32_t ms, EventHandler handler, void *context) override;
+    int call_every(uint32_t ms, EventHandler handler, void *context) override;
+    void cancel(int id) override;
+    void dispatch_for(uint32_t ms) override;
+};
+
+#endif // HOST_HAL_HPP
@@ -0,0 +1,366 @@
+// Host simulation: replays a recorded gyro + touch trace through the real
+// record/unlock application on virtual time.
+//
+//   pio run -e native && .pio/build/native/program [trace.csv] [--store file] [--verbose]
+//                                                  [--telemetry capture.bin] [--stream] [--profile]
+//                                                  [--no-spot]
+//
+// Telemetry is decoded to stdout as it is drained; --telemetry also saves the
+// raw byte stream for tools/telemetry_decode and --stream adds every sensor
+// sample to it. --profile sends the profile command at the end of the replay,
+// as typing 'p' into the serial terminal does on the target. --no-spot
+// replays without the always-on spotter.
+//
+// Every run starts from erased storage, so replaying a trace always gives the
+// same session. --store keeps the EEPROM image in a file instead, carrying
+// enrolled gestures and the gyro bias over to the next run.
+//
+// A trace is CSV, one line per sensor sample at the 200 Hz ODR:
+//   time_ms,x_raw,y_raw,z_raw,touch_x,touch_y
+// with touch_x = touch_y = 0 while the panel is not touched. Lines starting
+// with '#' are ignored. Without a trace a synthetic session is replayed:
+// enroll, a genuine attempt done 10% faster, an impostor attempt, then two
+// more genuine attempts after the board has dozed off, one woken by the
+// Unlock press and one by picking the board up. Last come an impostor and a
+// genuine gesture without any press, which only the always-on spotter acts on.
+//
+// The summary estimates the energy the session took from what the MCU, the
+// gyro and the display were doing each millisecond, and the share of the
+// MCU the spotter would take from the DTW cells it updated.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "app.hpp"
+#include "bias_store.hpp"
+#include "file_storage.hpp"
+#include "gyroscope.hpp"
+#include "host_hal.hpp"
+#include "host_telemetry.hpp"
+#include "mock_spi_bus.hpp"
+#include "power_manager.hpp"
+#include "profiler.hpp"
+#include "sampler.hpp"
+#include "telemetry.hpp"
+#include "template_store.hpp"
+
+constexpr uint8_t FIFO_WATERMARK = 8;
+
+// Rough supply currents from the STM32F429, L3GD20 and DISCO-F429ZI LCD
+// datasheets: good for comparing power policies, not for sizing a battery
+constexpr double MCU_RUN_MA = 100.0; // 180 MHz with LTDC, FMC and DMA2D clocked
+constexpr double MCU_STOP_MA = 0.3;
+constexpr double LCD_MA = 40.0; // panel and backlight
+constexpr double GYRO_MA[] = {0.005, 2.0, 6.1}; // indexed by MockSpiBus::Power
+constexpr double SUPPLY_V = 3.0;
+
+// Cortex-M4 cycles per spotter DTW cell, counted from its inner loop: three
+// squared differences, a three-way minimum carrying the start, two stores
+constexpr double SPOT_CYCLES_PER_CELL = 30.0;
+constexpr double MCU_HZ = 180e6;
+
+struct TraceRow
+{
+    uint32_t time_ms;
+    int16_t x, y, z;
+    uint16_t touch_x, touch_y;
+};
+
+struct Replay
+{
+    std::vector<TraceRow> rows;
+    size_t cursor = 0;
+    MockSpiBus *bus;
+    Sampler *sampler;
+    HostTouch *touch;
+    HostDisplay *display;
+    bool sampling = false; // the sampler owns the FIFO; before that calibration reads it
+
+    double charge_mc = 0; // integrated supply current, mA * s
+    uint32_t deep_sleep_ms = 0;
+};
+
+static bool load_trace(const char *path, std::vector<TraceRow> &rows)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || line[0] == '\n')
+        {
+            continue;
+        }
+        unsigned t, tx, ty;
+        int x, y, z;
+        if (sscanf(line, "%u,%d,%d,%d,%u,%u", &t, &x, &y, &z, &tx, &ty) == 6)
+        {
+            rows.push_back({t, (int16_t)x, (int16_t)y, (int16_t)z, (uint16_t)tx, (uint16_t)ty});
+        }
+    }
+
+    fclose(file);
+    return !rows.empty();
+}
+
+// appends `duration_ms` of samples; `speed` stretches the gesture in time and
+// `shape` selects one of two distinct wrist motions (0 = idle)
+static void synthesize(std::vector<TraceRow> &rows, uint32_t duration_ms, int shape, double speed,
+                       uint16_t touch_x = 0, uint16_t touch_y = 0, uint32_t touch_ms = 0)
+{
+    uint32_t start = rows.empty() ? 0 : rows.back().time_ms + 5;
+    for (uint32_t t = 0; t < duration_ms; t += 5)
+    {
+        double phase = 2 * M_PI * t * speed / 3000.0;
+        double noise = (rand() % 80) - 40;
+        double x = 0, y = 0, z = 0;
+        if (shape == 1)
+        {
+            x = 9000 * sin(phase);
+            y = 5000 * sin(2 * phase);
+            z = 2500 * cos(phase);
+        }
+        else if (shape == 2)
+        {
+            x = -7000 * sin(2 * phase);
+            y = 8000 * cos(phase);
+            z = -4000 * sin(phase);
+        }
+        bool touching = t < touch_ms && t != 10; // the contact bounces once
+        rows.push_back({start + t, (int16_t)(x + noise), (int16_t)(y + noise), (int16_t)(z + noise),
+                        (uint16_t)(touching ? touch_x : 0), (uint16_t)(touching ? touch_y : 0)});
+    }
+}
+
+static void synthetic_session(std::vector<TraceRow> &rows)
+{
+    const uint16_t RECORD_X = 170, UNLOCK_X = 60, BUTTON_Y = 30;
+
+    synthesize(rows, 1000, 0, 1.0);
+    synthesize(rows, 300, 0, 1.0, RECORD_X, BUTTON_Y, 300); // press Record
+    synthesize(rows, 800, 0, 1.0);                          // getting ready, not part of the gesture
+    synthesize(rows, 3000, 1, 1.0);                         // enrolled gesture
+    synthesize(rows, 1500, 0, 1.0);
+    synthesize(rows, 300, 0, 1.0, UNLOCK_X, BUTTON_Y, 300); // press Unlock
+    synthesize(rows, 1200, 0, 1.0);
+    synthesize(rows, 2730, 1, 1.1);                         // same gesture, a little faster
+    synthesize(rows, 7000, 0, 1.0);                         // success animation
+    synthesize(rows, 300, 0, 1.0, UNLOCK_X, BUTTON_Y, 300);
+    synthesize(rows, 500, 0, 1.0);
+    synthesize(rows, 3000, 2, 1.0); // someone else's gesture
+    synthesize(rows, 40000, 0, 1.0); // left alone, dozes off
+    synthesize(rows, 300, 0, 1.0, UNLOCK_X, BUTTON_Y, 300); // the press wakes it and counts
+    synthesize(rows, 1200, 0, 1.0);
+    synthesize(rows, 2850, 1, 1.05);
+    synthesize(rows, 40000, 0, 1.0); // dozes off again
+    synthesize(rows, 1000, 1, 1.0); // picked up: motion wakes it
+    synthesize(rows, 500, 0, 1.0);
+    synthesize(rows, 300, 0, 1.0, UNLOCK_X, BUTTON_Y, 300);
+    synthesize(rows, 1200, 0, 1.0);
+    synthesize(rows, 3000, 1, 1.0);
+    synthesize(rows, 7000, 0, 1.0);
+    synthesize(rows, 3000, 2, 1.0); // someone else, no press
+    synthesize(rows, 2000, 0, 1.0);
+    synthesize(rows, 2850, 1, 1.05); // the owner, no press
+    synthesize(rows, 7000, 0, 1.0);
+}
+
+// plays the part of the sensor, the touch panel and the sampler thread
+static void on_tick(uint32_t now_ms, void *context)
+{
+    Replay &replay = *(Replay *)context;
+
+    bool deep_sleep = host_deep_sleep_allowed();
+    double current_ma = (deep_sleep ? MCU_STOP_MA : MCU_RUN_MA) + (replay.display->on ? LCD_MA : 0.0) +
+                        GYRO_MA[replay.bus->power()];
+    replay.charge_mc += current_ma / 1000.0;
+    replay.deep_sleep_ms += deep_sleep;
+
+    while (replay.cursor < replay.rows.size() && replay.rows[replay.cursor].time_ms <= now_ms)
+    {
+        const TraceRow &row = replay.rows[replay.cursor++];
+        replay.bus->push_sample(row.x, row.y, row.z);
+        replay.touch->set(row.touch_x != 0 && row.touch_y != 0, row.touch_x, row.touch_y);
+
+        if (replay.sampling && replay.bus->level() >= FIFO_WATERMARK)
+        {
+            replay.sampler->drain(now_ms * 1000);
+        }
+    }
+}
+
+// what the target's low priority drain thread does, between dispatches
+static void pump_telemetry(TelemetryDecoder &decoder, FILE *capture)
+{
+    uint8_t buf[TELEMETRY_MAX_FRAME * 4];
+    size_t len;
+    while ((len = telemetry_drain(buf, sizeof(buf))) > 0)
+    {
+        if (capture)
+        {
+            fwrite(buf, 1, len, capture);
+        }
+        decoder.feed(buf, len);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = nullptr;
+    const char *store_path = nullptr; // a temporary file unless --store
+    const char *capture_path = nullptr;
+    bool verbose = false;
+    bool profile = false;
+    bool always_on = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--store") == 0 && i + 1 < argc)
+        {
+            store_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc)
+        {
+            capture_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--stream") == 0)
+        {
+            telemetry_set_streaming(true);
+        }
+        else if (strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else if (strcmp(argv[i], "--profile") == 0)
+        {
+            profile = true;
+        }
+        else if (strcmp(argv[i], "--no-spot") == 0)
+        {
+            always_on = false;
+        }
+        else
+        {
+            trace_path = argv[i];
+        }
+    }
+
+    MockSpiBus bus;
+    Gyro gyro(bus);
+    Sampler sampler(gyro);
+    HostDisplay display;
+    HostTouch touch;
+    HostEventLoop events;
+    FileStorage storage(8 * 1024, 4);
+    TemplateStore template_store(storage);
+    BiasStore bias_store(storage, template_store.end());
+
+    display.verbose = verbose;
+
+    Replay replay;
+    replay.bus = &bus;
+    replay.sampler = &sampler;
+    replay.touch = &touch;
+    replay.display = &display;
+
+    if (trace_path ? !load_trace(trace_path, replay.rows) : (synthetic_session(replay.rows), false))
+    {
+        fprintf(stderr, "could not read trace %s\n", trace_path);
+        return 1;
+    }
+
+    FILE *capture = nullptr;
+    if (capture_path && !(capture = fopen(capture_path, "wb")))
+    {
+        fprintf(stderr, "could not create %s\n", capture_path);
+        return 1;
+    }
+    TelemetryDecoder decoder;
+
+    host_set_tick_hook(on_tick, &replay);
+    auto wall_start = std::chrono::steady_clock::now();
+
+    telemetry_log(TM_BOOT);
+    PROFILE_INIT();
+    if (!gyro.init())
+    {
+        fprintf(stderr, "gyro did not accept its configuration\n");
+        return 1;
+    }
+    PowerManager power(gyro, sampler, display, events);
+    App app(display, touch, sampler, power, template_store, bias_store, events);
+    app.setup(gyro, storage.open(store_path));
+    app.set_always_on(always_on);
+    sampler.start(FIFO_WATERMARK);
+    replay.sampling = true;
+
+    app.start();
+    while (replay.cursor < replay.rows.size())
+    {
+        pump_telemetry(decoder, capture);
+        events.dispatch_for(App::TICK_MS);
+    }
+    if (profile)
+    {
+        telemetry_post_command(TELEMETRY_CMD_PROFILE);
+        events.dispatch_for(App::TICK_MS);
+    }
+    pump_telemetry(decoder, capture);
+    if (capture)
+    {
+        fclose(capture);
+    }
+
+    double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+    double sim_ms = hal_now_ms();
+
+    App::Results results = app.results();
+    Sampler::Stats stats = sampler.stats();
+
+    fprintf(stderr, "\n--- replay summary ---\n");
+    fprintf(stderr, "samples: %zu replayed, %lu delivered, %lu dropped\n", replay.rows.size(),
+            (unsigned long)stats.samples, (unsigned long)stats.ring_drops);
+    fprintf(stderr, "recordings: %lu, unlocks: %lu, rejections: %lu, spotted: %lu\n",
+            (unsigned long)results.recordings, (unsigned long)results.unlocks, (unsigned long)results.rejections,
+            (unsigned long)results.spotted);
+    fprintf(stderr, "telemetry: %lu frames, %lu samples streamed, %lu frames dropped\n",
+            (unsigned long)decoder.counters.frames, (unsigned long)decoder.counters.samples,
+            (unsigned long)telemetry_dropped());
+    fprintf(stderr, "spi: %u transactions, %u bytes\n", bus.transactions, bus.bytes_transferred);
+    fprintf(stderr, "touch: %lu controller reads\n", (unsigned long)touch.reads);
+    fprintf(stderr, "lcd: %lu clears, %lu strings, %lu text runs of %lu glyphs, %lu rects, %llu pixels filled\n",
+            (unsigned long)display.counters.clears, (unsigned long)display.counters.strings,
+            (unsigned long)display.counters.runs, (unsigned long)display.counters.glyphs,
+            (unsigned long)display.counters.rects, (unsigned long long)display.counters.pixels_filled);
+    fprintf(stderr, "lcd: %lu frames, %llu pixels synced between buffers\n",
+            (unsigned long)display.counters.frames, (unsigned long long)display.counters.pixels_synced);
+    fprintf(stderr, "lcd: %lu chart columns, %llu pixels\n", (unsigned long)display.counters.plot_columns,
+            (unsigned long long)display.counters.plot_pixels);
+    GestureSpotter::Stats spotter = app.spotter_stats();
+    if (spotter.samples > 0)
+    {
+        // samples arrive at the segmenter's rate while spotting
+        double spot_s = spotter.samples / (double)Segmenter::RATE_HZ;
+        double cycles = spotter.cells * SPOT_CYCLES_PER_CELL;
+        fprintf(stderr, "spotter: %lu samples, %llu DTW cells, at most %lu for one sample\n",
+                (unsigned long)spotter.samples, (unsigned long long)spotter.cells, (unsigned long)spotter.peak_cells);
+        fprintf(stderr, "spotter: %.2f%% of the MCU while spotting, %.2f%% of the session, %.0f us peak per sample\n",
+                100.0 * cycles / (spot_s * MCU_HZ), sim_ms > 0 ? 100.0 * cycles / (sim_ms / 1000.0 * MCU_HZ) : 0.0,
+                spotter.peak_cells * SPOT_CYCLES_PER_CELL / MCU_HZ * 1e6);
+    }
+    double energy_mj = replay.charge_mc * SUPPLY_V;
+    fprintf(stderr, "energy: %.0f mJ, %.0f mJ per unlock, deep sleep %.0f%% of the time\n", energy_mj,
+            results.unlocks > 0 ? energy_mj / results.unlocks : 0.0, sim_ms > 0 ? 100.0 * replay.deep_sleep_ms / sim_ms : 0.0);
+    fprintf(stderr, "time: %.0f ms simulated in %.1f ms (%.0fx real time)\n", sim_ms, wall_ms,
+            wall_ms > 0 ? sim_ms / wall_ms : 0.0);
+
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include "profiler.hpp"
+
+#if PROFILING_ENABLED
+
+#include <chrono>
+
+// Wall time, not the simulation's virtual clock: it measures what the code
+// costs on the host, which is the only thing a replay can tell about it.
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+void profile_clock_init()
+{
+}
+
+uint32_t profile_ticks()
+{
+    auto elapsed = std::chrono::steady_clock::now() - epoch;
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+uint32_t profile_ticks_to_us(uint32_t ticks)
+{
+    return ticks;
+}
+
+#endif // PROFILING_ENABLED
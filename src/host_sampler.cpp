@@ -0,0 +1,29 @@
+#include "sampler.hpp"
+
+// On the host there is no acquisition thread: the simulation calls drain()
+// itself whenever the mock gyro's FIFO reaches the watermark.
+bool Sampler::start(uint8_t level)
+{
+    watermark = level;
+    nominal_interval_us = (uint32_t)watermark * 1'000'000 / ODR_HZ;
+
+    return gyro.enable_fifo(watermark);
+}
+
+void Sampler::suspend()
+{
+    gyro.disable_fifo();
+}
+
+void Sampler::drain(uint32_t timestamp_us)
+{
+    // the mock bus completes both transfers before this returns
+    gyro.read_fifo_async(nullptr, nullptr);
+    collect(timestamp_us);
+}
+
+bool Sampler::resume()
+{
+    resumed = true;
+    return gyro.enable_fifo(watermark);
+}
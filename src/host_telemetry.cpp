@@ -0,0 +1,239 @@
+#include "host_telemetry.hpp"
+
+#include "power_manager.hpp"
+#include "profiler.hpp"
+
+// Event formats live only here, so the firmware never links a format string.
+// Indexed by TelemetryId; every argument is printed as a long.
+struct EventFormat
+{
+    const char *name; // matches the TelemetryId, for reading the table
+    const char *format;
+};
+
+static const EventFormat FORMATS[] = {
+    {"boot", "Booted"},
+    {"gyro_init_failed", "Gyroscope initialization failed"},
+    {"sampler_start_failed", "Sampler start failed"},
+    {"bias_restored", "Gyroscope bias restored (xyz, 1/1000 count): %ld, %ld, %ld"},
+    {"calibrated", "Gyroscope calibrated in %ld ms (xyz, 1/1000 count): %ld, %ld, %ld"},
+    {"calibration_timeout", "Gyroscope calibration timed out, tracking bias in the background"},
+    {"recording", "Recording..."},
+    {"unlocking", "Unlocking..."},
+    {"persist_failed", "Failed to persist gesture"},
+    {"similarity", "Similarity (Q15): %ld"},
+    {"unlocked", "Successfully unlocked"},
+    {"rejected", "Failed to unlock"},
+    {"sampler_stats", "Sampler: %ld samples, %ld dropped, %ld FIFO overruns"},
+    {"sampler_timing", "Sampler interval (us): min %ld, mean %ld, max %ld, jitter %ld"},
+    {"match_energy", "Energy1: %ld, Energy2: %ld (Q15)"},
+    {"match_sums", "Sum gesture%ld: %ld, %ld, %ld"},
+    {"match_mse", "MSE: %ld (Q15)"},
+    {"match_terms", "Normalized (Q15): mse %ld, energy %ld, sign %ld"},
+    {"match_result", "Final Similarity: %ld (Q15)"},
+    {"dtw_cost", "DTW cost: %ld (Q22), similarity: %ld (Q15)"},
+    {"dtw_abandoned", "DTW: abandoned above %ld (Q22)"},
+    {"samples", nullptr},
+    {"segment", "Gesture segmented: %ld samples"},
+    {"segment_timeout", "No gesture detected"},
+    {"profile_stage", "Profile %-16s %ld samples, max %ld us"},
+    {"profile_percentiles", "Profile %-16s p50 %ld us, p99 %ld us"},
+    {"enrolled", "Enrolled user %ld"},
+    {"identify", "Identify: %ld bounded, %ld fully compared of %ld templates"},
+    {"identified", "Identified user %ld"},
+    {"dozing", "Dozing after %ld ms idle"},
+    {"standby", "Gyro powered down after dozing %ld ms"},
+    {"wake", "Woken by %s in %ld ms after %ld ms asleep"},
+    {"pause_scored", "Scored at a pause: %ld samples, similarity %ld (Q15), ending early %ld"},
+    {"spotted", "Spotted user %ld without a press: similarity %ld (Q15), %ld samples"},
+    {"spot_full", "Spotter full, user %ld is not spotted"},
+};
+
+static_assert(sizeof(FORMATS) / sizeof(FORMATS[0]) == TM_ID_COUNT, "every telemetry id needs a format");
+
+// the first argument of the profile events, indexed by ProfileStage
+static const char *const STAGE_NAMES[] = {
+    "spi_burst", "touch_poll", "display_xyz", "resample", "match", "render", "ui_tick", "touch_to_verdict", "filter", "wake",
+    "verdict", "plot", "spot",
+};
+
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == PROF_STAGE_COUNT, "every stage needs a name");
+
+static const char *stage_name(long stage)
+{
+    return stage >= 0 && stage < PROF_STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+// the first argument of TM_WAKE, indexed by WakeSource
+static const char *const WAKE_SOURCES[] = {"touch", "motion"};
+
+static_assert(sizeof(WAKE_SOURCES) / sizeof(WAKE_SOURCES[0]) == WAKE_SOURCE_COUNT, "every wake source needs a name");
+
+static const char *wake_source(long source)
+{
+    return source >= 0 && source < WAKE_SOURCE_COUNT ? WAKE_SOURCES[source] : "?";
+}
+
+// reads one varint, false if it runs past the end
+static bool get_varint(const uint8_t *&p, const uint8_t *end, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7)
+    {
+        uint8_t byte = *p++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool get_signed(const uint8_t *&p, const uint8_t *end, int32_t &value)
+{
+    uint32_t zigzag;
+    if (!get_varint(p, end, zigzag))
+    {
+        return false;
+    }
+    value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    return true;
+}
+
+void TelemetryDecoder::feed(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        uint8_t byte = data[i];
+        if (length == 0 && byte != TELEMETRY_SYNC)
+        {
+            continue; // hunting for the start of a frame
+        }
+        frame[length++] = byte;
+
+        if (length >= 3 && length == 3u + frame[2] + 1u)
+        {
+            if (telemetry_crc8(&frame[1], length - 2) == frame[length - 1])
+            {
+                counters.frames++;
+                handle_frame();
+                length = 0;
+            }
+            else
+            {
+                // resync on the next sync byte inside what was buffered
+                counters.bad_frames++;
+                size_t next = 1;
+                while (next < length && frame[next] != TELEMETRY_SYNC)
+                {
+                    next++;
+                }
+                size_t rest = length - next;
+                uint8_t pending[TELEMETRY_MAX_FRAME];
+                for (size_t k = 0; k < rest; ++k)
+                {
+                    pending[k] = frame[next + k];
+                }
+                length = 0;
+                feed(pending, rest);
+            }
+        }
+    }
+}
+
+void TelemetryDecoder::handle_frame()
+{
+    uint8_t id = frame[1];
+    const uint8_t *p = &frame[3];
+    const uint8_t *end = p + frame[2];
+
+    if (id == TM_SAMPLES)
+    {
+        handle_samples(p, frame[2]);
+        return;
+    }
+
+    uint32_t time_ms;
+    long args[TELEMETRY_MAX_ARGS] = {0, 0, 0, 0};
+    if (id >= TM_ID_COUNT || !get_varint(p, end, time_ms))
+    {
+        counters.bad_frames++;
+        return;
+    }
+    for (size_t i = 0; i < TELEMETRY_MAX_ARGS && p < end; ++i)
+    {
+        int32_t value;
+        if (!get_signed(p, end, value))
+        {
+            counters.bad_frames++;
+            return;
+        }
+        args[i] = value;
+    }
+
+    if (text)
+    {
+        if (timestamps)
+        {
+            fprintf(text, "[%8lu ms] ", (unsigned long)time_ms);
+        }
+        if (id == TM_PROFILE_STAGE || id == TM_PROFILE_PERCENTILES)
+        {
+            fprintf(text, FORMATS[id].format, stage_name(args[0]), args[1], args[2]);
+        }
+        else if (id == TM_WAKE)
+        {
+            fprintf(text, FORMATS[id].format, wake_source(args[0]), args[1], args[2]);
+        }
+        else
+        {
+            fprintf(text, FORMATS[id].format, args[0], args[1], args[2], args[3]);
+        }
+        fputc('\n', text);
+    }
+}
+
+void TelemetryDecoder::handle_samples(const uint8_t *p, size_t len)
+{
+    const uint8_t *end = p + len;
+    uint32_t time_ms, sequence, count;
+    if (!get_varint(p, end, time_ms) || !get_varint(p, end, sequence) || !get_varint(p, end, count))
+    {
+        counters.bad_frames++;
+        return;
+    }
+
+    if (sequence_known && sequence != next_sequence)
+    {
+        counters.lost_samples += sequence - next_sequence;
+    }
+    sequence_known = true;
+    next_sequence = sequence + count;
+
+    int32_t value[3] = {0, 0, 0};
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            int32_t delta;
+            if (!get_signed(p, end, delta))
+            {
+                counters.bad_frames++;
+                return;
+            }
+            value[k] += delta;
+        }
+        counters.samples++;
+        if (on_sample)
+        {
+            Sample sample = {time_ms, sequence + i, (int16_t)value[0], (int16_t)value[1], (int16_t)value[2]};
+            on_sample(sample, context);
+        }
+    }
+}
+
+void telemetry_start()
+{
+    // the simulation drains between event loop dispatches
+}
@@ -0,0 +1,53 @@
+#ifndef HOST_TELEMETRY_HPP
+#define HOST_TELEMETRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "telemetry.hpp"
+
+// Host side of the telemetry channel: reassembles frames from a byte stream,
+// formats events as the text the firmware used to print and hands streamed
+// samples to a callback. Resynchronizes on the next sync byte after noise
+// or a corrupt frame.
+class TelemetryDecoder
+{
+public:
+    struct Sample
+    {
+        uint32_t time_ms;  // drain time of the batch the sample came in
+        uint32_t sequence; // counts every sample the sampler streamed
+        int16_t x, y, z;
+    };
+
+    typedef void (*SampleHandler)(const Sample &sample, void *context);
+
+    struct Counters
+    {
+        uint32_t frames;
+        uint32_t bad_frames;   // CRC or length errors
+        uint32_t samples;
+        uint32_t lost_samples; // sequence gaps, i.e. frames dropped on the target
+    };
+
+    FILE *text = stdout;      // formatted events, nullptr to drop them
+    bool timestamps = false;  // prefix events with the target time
+    SampleHandler on_sample = nullptr;
+    void *context = nullptr;
+
+    Counters counters = {};
+
+    void feed(const uint8_t *data, size_t len);
+
+private:
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t length = 0;
+    uint32_t next_sequence = 0;
+    bool sequence_known = false;
+
+    void handle_frame();
+    void handle_samples(const uint8_t *payload, size_t len);
+};
+
+#endif // HOST_TELEMETRY_HPP
@@ -0,0 +1,208 @@
+#include "match_policy.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+// ----- Weighted -----
+
+void WeightedMatcher::features(const Gesture &g, Features &out)
+{
+    out.energy = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        out.sums[k] = 0;
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            out.energy += abs(g.axis[k][i]);
+            out.sums[k] += g.axis[k][i];
+        }
+    }
+}
+
+// The energy and sign terms are exact. By Cauchy-Schwarz the summed squared
+// difference is at least energy_diff^2 / (SAMPLES * 3), which bounds the MSE
+// term; the -2 covers the rounding in the fixed point MSE.
+int32_t WeightedMatcher::similarity_upper_bound(const Features &a, const Features &b)
+{
+    const uint64_t n = SAMPLES * 3;
+    uint32_t energy_diff = (uint32_t)abs(a.energy - b.energy);
+    int64_t mse = (int64_t)((uint64_t)energy_diff * energy_diff / (n * n * Q15_ONE)) - 2;
+
+    int sign_diff = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        if ((a.sums[k] >= 0) != (b.sums[k] >= 0))
+        {
+            sign_diff++;
+        }
+    }
+
+    SimilarityTerms terms;
+    terms.mse = mse > 0 ? (int32_t)((1u << 30) / (uint32_t)(Q15_ONE + mse)) : Q15_ONE;
+    terms.energy = (int32_t)((1u << 30) / (uint32_t)(Q15_ONE + energy_diff));
+    terms.sign = (3 - sign_diff) * Q15_ONE / 3;
+    return weigh_similarity(terms, SIMILARITY_WEIGHTS);
+}
+
+// ----- DTW -----
+
+void DtwMatcher::features(const Gesture &g, Features &out)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            int begin = i - DTW_BAND < 0 ? 0 : i - DTW_BAND;
+            int end = i + DTW_BAND >= SAMPLES ? SAMPLES - 1 : i + DTW_BAND;
+            q15_t hi = g.axis[k][begin], lo = hi;
+            for (int j = begin + 1; j <= end; ++j)
+            {
+                hi = g.axis[k][j] > hi ? g.axis[k][j] : hi;
+                lo = g.axis[k][j] < lo ? g.axis[k][j] : lo;
+            }
+            out.upper.axis[k][i] = hi;
+            out.lower.axis[k][i] = lo;
+        }
+    }
+}
+
+// cost of one DTW cell, the same sum dtw_distance() builds
+static uint32_t cell_cost(const Gesture &a, int i, const Gesture &b, int j)
+{
+    return dtw_square(a.axis[0][i] - b.axis[0][j]) + dtw_square(a.axis[1][i] - b.axis[1][j]) +
+           dtw_square(a.axis[2][i] - b.axis[2][j]);
+}
+
+// Every warping path starts at (0, 0), ends at (SAMPLES - 1, SAMPLES - 1)
+// and visits each row once at least, within the band. The corner cells are
+// exact; any other row costs at least the probe's distance to the entry's
+// envelope (LB_Keogh). Gives up once the sum passes `limit`.
+uint32_t DtwMatcher::bound(const Gesture &probe, const Features &, const Gesture &entry, const Features &ef,
+                           uint32_t limit)
+{
+    uint32_t bound = cell_cost(probe, 0, entry, 0) + cell_cost(probe, SAMPLES - 1, entry, SAMPLES - 1);
+    for (int i = 1; i < SAMPLES - 1 && bound <= limit; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            int32_t q = probe.axis[k][i];
+            if (q > ef.upper.axis[k][i])
+            {
+                bound += dtw_square(q - ef.upper.axis[k][i]);
+            }
+            else if (q < ef.lower.axis[k][i])
+            {
+                bound += dtw_square(ef.lower.axis[k][i] - q);
+            }
+        }
+    }
+    return bound;
+}
+
+// ----- Correlation -----
+
+void CorrelationMatcher::features(const Gesture &g, Features &out)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        int32_t sum = 0;
+        int64_t squares = 0; // Q30
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            sum += g.axis[k][i];
+            squares += (int32_t)g.axis[k][i] * g.axis[k][i];
+        }
+        out.sums[k] = sum;
+        // sum of (x - mean)^2 = sum of x^2 - sum^2 / n
+        int64_t centred = squares - (int64_t)sum * sum / SAMPLES;
+        out.norms[k] = (int32_t)lround(sqrt((double)(centred > 0 ? centred : 0)));
+    }
+}
+
+int32_t CorrelationMatcher::correlation(const Gesture &a, const Features &af, const Gesture &b, const Features &bf)
+{
+    int64_t covariance = 0; // Q30, summed over the axes
+    int64_t scale = 0;      // Q30, its largest possible value
+    for (int k = 0; k < 3; ++k)
+    {
+        int64_t products = 0;
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            products += (int32_t)a.axis[k][i] * b.axis[k][i];
+        }
+        covariance += products - (int64_t)af.sums[k] * bf.sums[k] / SAMPLES;
+        scale += (int64_t)af.norms[k] * bf.norms[k];
+    }
+
+    // a flat gesture correlates with nothing
+    if (covariance <= 0 || scale == 0)
+    {
+        return 0;
+    }
+    return covariance >= scale ? Q15_ONE : (int32_t)(covariance * Q15_ONE / scale);
+}
+
+// ----- Spectral -----
+
+// cos and sin of 2 pi m / SAMPLES in Q15
+struct Twiddles
+{
+    int32_t cosine[SAMPLES];
+    int32_t sine[SAMPLES];
+
+    Twiddles()
+    {
+        for (int m = 0; m < SAMPLES; ++m)
+        {
+            cosine[m] = (int32_t)lround(cos(2 * M_PI * m / SAMPLES) * (Q15_ONE - 1));
+            sine[m] = (int32_t)lround(sin(2 * M_PI * m / SAMPLES) * (Q15_ONE - 1));
+        }
+    }
+};
+
+// built on first use, which is safe from any thread
+static const Twiddles &twiddles()
+{
+    static const Twiddles table;
+    return table;
+}
+
+void SpectralMatcher::features(const Gesture &g, Features &out)
+{
+    const Twiddles &t = twiddles();
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int bin = 0; bin < SPECTRUM_BINS; ++bin)
+        {
+            // X[bin] / SAMPLES, so the DC bin is the mean
+            int64_t re = 0, im = 0; // Q30
+            for (int i = 0; i < SAMPLES; ++i)
+            {
+                int m = bin * i % SAMPLES;
+                re += (int64_t)g.axis[k][i] * t.cosine[m];
+                im -= (int64_t)g.axis[k][i] * t.sine[m];
+            }
+            out.re[k][bin] = (int32_t)(re / SAMPLES >> 15);
+            out.im[k][bin] = (int32_t)(im / SAMPLES >> 15);
+        }
+    }
+}
+
+uint32_t SpectralMatcher::spectral_distance(const Features &a, const Features &b, int bins)
+{
+    // Parseval: the mean square of a real signal is |X0|^2 plus twice every
+    // other |Xk|^2 below the Nyquist bin, with X scaled by 1 / SAMPLES
+    uint64_t sum = 0; // Q30
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int bin = 0; bin < bins; ++bin)
+        {
+            int64_t re = a.re[k][bin] - b.re[k][bin];
+            int64_t im = a.im[k][bin] - b.im[k][bin];
+            uint64_t power = (uint64_t)(re * re + im * im);
+            sum += bin == 0 ? power : 2 * power;
+        }
+    }
+    uint64_t mean = sum / 3 >> 8; // Q22, per axis
+    return mean > UINT32_MAX ? UINT32_MAX : (uint32_t)mean;
+}
@@ -0,0 +1,203 @@
+#ifndef MATCH_POLICY_HPP
+#define MATCH_POLICY_HPP
+
+#include <cstdint>
+
+#include "dtw.hpp"
+#include "matcher.hpp"
+
+// Matching policies for TemplateIndex. The policy is a template parameter,
+// so the unlock path is built for exactly one metric and every call below is
+// resolved, and mostly inlined, at compile time. A policy provides
+//
+//   struct Features;  what it precomputes per gesture, kept next to every
+//                     template and computed once per probe
+//   static void features(const Gesture &g, Features &out);
+//
+//   static const uint32_t ACCEPT_COST;  costs below this may unlock
+//
+//   // lower is closer; may give up and return anything >= limit once the
+//   // cost cannot end up below it
+//   static uint32_t cost(const Gesture &probe, const Features &pf,
+//                        const Gesture &entry, const Features &ef, uint32_t limit);
+//
+//   // never above cost(): entries bounded at or above the best cost so far
+//   // are skipped, so a loose bound costs time and a wrong one accuracy
+//   static uint32_t bound(...same arguments...);
+//
+//   // compare entries best bound first; worth it when bounds vary enough
+//   // that an early good match prunes the rest, otherwise one pass in
+//   // storage order skips the ordering, which is quadratic in the entries
+//   static const bool ORDERED;
+//
+//   static int32_t similarity(uint32_t cost);  Q15, what telemetry reports
+//   static const char *name();
+//
+// tools/match_eval checks every policy against these rules and reports its
+// accuracy and speed on the same corpus.
+
+// calculate_similarity(): MSE, energy and sign blended by SIMILARITY_WEIGHTS
+struct WeightedMatcher
+{
+    struct Features
+    {
+        int32_t energy;  // sum of |sample| over all axes, Q15
+        int32_t sums[3]; // per-axis sums, Q15
+    };
+
+    static const uint32_t ACCEPT_COST = Q15_ONE - ACCEPT_THRESHOLD;
+    static const bool ORDERED = true;
+
+    static void features(const Gesture &g, Features &out);
+
+    static uint32_t cost(const Gesture &probe, const Features &, const Gesture &entry, const Features &, uint32_t)
+    {
+        return (uint32_t)(Q15_ONE - weigh_similarity(similarity_terms(probe, entry), SIMILARITY_WEIGHTS));
+    }
+
+    static uint32_t bound(const Gesture &, const Features &pf, const Gesture &, const Features &ef, uint32_t)
+    {
+        return (uint32_t)(Q15_ONE - similarity_upper_bound(pf, ef));
+    }
+
+    static int32_t similarity(uint32_t cost)
+    {
+        return Q15_ONE - (int32_t)cost;
+    }
+
+    static const char *name()
+    {
+        return "weighted";
+    }
+
+    // highest score calculate_similarity() can give a pair with these features
+    static int32_t similarity_upper_bound(const Features &a, const Features &b);
+};
+
+// dtw_distance() within DTW_BAND, bounded by LB_Keogh
+struct DtwMatcher
+{
+    struct Features
+    {
+        Gesture upper, lower; // per-axis max/min over +-DTW_BAND samples
+    };
+
+    static const uint32_t ACCEPT_COST = DTW_ACCEPT_LIMIT;
+    static const bool ORDERED = true;
+
+    static void features(const Gesture &g, Features &out);
+
+    static uint32_t cost(const Gesture &probe, const Features &, const Gesture &entry, const Features &,
+                         uint32_t limit)
+    {
+        return dtw_distance(probe, entry, DTW_BAND, limit);
+    }
+
+    static uint32_t bound(const Gesture &probe, const Features &, const Gesture &entry, const Features &ef,
+                          uint32_t limit);
+
+    static int32_t similarity(uint32_t cost)
+    {
+        return dtw_cost_similarity(cost);
+    }
+
+    static const char *name()
+    {
+        return "dtw";
+    }
+};
+
+// Pearson correlation over all three axes: the summed per-axis covariances
+// over the summed products of the per-axis deviations. Insensitive to how
+// big the motion was, only its shape counts; anti-correlated scores 0.
+struct CorrelationMatcher
+{
+    struct Features
+    {
+        int32_t sums[3];  // per-axis sums, Q15
+        int32_t norms[3]; // per-axis root of the centred sum of squares, Q15
+    };
+
+    static const uint32_t ACCEPT_COST = Q15_ONE - ACCEPT_THRESHOLD;
+    static const bool ORDERED = false;
+
+    static void features(const Gesture &g, Features &out);
+
+    static uint32_t cost(const Gesture &probe, const Features &pf, const Gesture &entry, const Features &ef,
+                         uint32_t)
+    {
+        return (uint32_t)(Q15_ONE - correlation(probe, pf, entry, ef));
+    }
+
+    // nothing short of the full dot product bounds a correlation
+    static uint32_t bound(const Gesture &, const Features &, const Gesture &, const Features &, uint32_t)
+    {
+        return 0;
+    }
+
+    static int32_t similarity(uint32_t cost)
+    {
+        return Q15_ONE - (int32_t)cost;
+    }
+
+    static const char *name()
+    {
+        return "correlation";
+    }
+
+    // Q15 in [0, 1]
+    static int32_t correlation(const Gesture &a, const Features &af, const Gesture &b, const Features &bf);
+};
+
+// Compares the lowest SPECTRUM_BINS DFT bins of every axis, i.e. the
+// gestures with everything above ~SPECTRUM_BINS periods per gesture filtered
+// out, so tremor and sensor noise cost nothing. The probe's spectrum is taken
+// once per search, after which each template is only 3 * SPECTRUM_BINS
+// complex differences.
+struct SpectralMatcher
+{
+    static const int SPECTRUM_BINS = 6;
+    static const uint32_t COST_SCALE = 20; // like DTW_COST_SCALE, sets where a repeat stops matching
+
+    struct Features
+    {
+        int32_t re[3][SPECTRUM_BINS]; // Q15
+        int32_t im[3][SPECTRUM_BINS];
+    };
+
+    // the cost at which similarity() drops to ACCEPT_THRESHOLD
+    static const uint32_t ACCEPT_COST =
+        (uint32_t)(((double)Q15_ONE / ACCEPT_THRESHOLD - 1.0) / COST_SCALE * (1 << 22));
+    static const bool ORDERED = false; // the DC bin prunes, but rarely enough to order by
+
+    static void features(const Gesture &g, Features &out);
+
+    static uint32_t cost(const Gesture &, const Features &pf, const Gesture &, const Features &ef, uint32_t)
+    {
+        return spectral_distance(pf, ef, SPECTRUM_BINS);
+    }
+
+    // every bin adds to the distance, so the DC bin alone is a lower bound
+    static uint32_t bound(const Gesture &, const Features &pf, const Gesture &, const Features &ef, uint32_t)
+    {
+        return spectral_distance(pf, ef, 1);
+    }
+
+    // 1 / (1 + scale * cost) like dtw_cost_similarity(), Q22 down to Q15
+    static int32_t similarity(uint32_t cost)
+    {
+        uint64_t scaled = (uint64_t)COST_SCALE * (cost >> 7);
+        return (int32_t)((1u << 30) / (Q15_ONE + (scaled > UINT32_MAX - Q15_ONE ? UINT32_MAX - Q15_ONE : scaled)));
+    }
+
+    static const char *name()
+    {
+        return "spectral";
+    }
+
+    // mean squared difference of the low-passed gestures in Q22, by Parseval
+    // from the first `bins` bins
+    static uint32_t spectral_distance(const Features &a, const Features &b, int bins);
+};
+
+#endif // MATCH_POLICY_HPP
@@ -0,0 +1,136 @@
+#include "matcher.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+#include "telemetry.hpp"
+
+q15_t normalize(int16_t value)
+{
+    // a raw reading over the full int16 range already is a Q15 fraction of
+    // full scale, so normalizing is free
+    return value;
+}
+
+// the normalized terms, logging the intermediate values when `log` is set
+static SimilarityTerms compare(const Gesture &gesture1, const Gesture &gesture2, bool log)
+{
+    int32_t energy1 = 0, energy2 = 0; // Q15, at most 90.0
+
+    int32_t sum_gesture1[3] = {0}, sum_gesture2[3] = {0};
+
+    uint32_t mse = 0; // Q22 while accumulating, Q15 once averaged
+
+    // Compute cumulative sums and energy for each gesture
+    for (int j = 0; j < 3; ++j)
+    {
+        const q15_t *a = gesture1.axis[j];
+        const q15_t *b = gesture2.axis[j];
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            // calculating energy of both signals
+            energy1 += abs(a[i]);
+            energy2 += abs(b[i]);
+            // calculate sum
+            sum_gesture1[j] += a[i];
+            sum_gesture2[j] += b[i];
+            // Calculate MSE; |diff| < 2^16 so its Q30 square fits in 32 bits
+            // unsigned, and 90 of them shifted down to Q22 still do
+            uint32_t diff = (uint32_t)abs(a[i] - b[i]);
+            mse += (diff * diff + 128) >> 8; // sum of squared differences, rounded
+        }
+    }
+
+    mse = (mse / (SAMPLES * 3)) >> 7; //This holds the total mean squared error; Smaller error means more similarity
+
+    if (log)
+    {
+        telemetry_log(TM_MATCH_ENERGY, energy1, energy2);
+        telemetry_log(TM_MATCH_SUMS, 1, sum_gesture1[0], sum_gesture1[1], sum_gesture1[2]);
+        telemetry_log(TM_MATCH_SUMS, 2, sum_gesture2[0], sum_gesture2[1], sum_gesture2[2]);
+        telemetry_log(TM_MATCH_MSE, (int32_t)mse);
+    }
+
+    // Energy Diff
+    int32_t energy_diff = abs(energy1 - energy2);
+    // Sign Diff
+    int sign_diff = 0;
+    for (int k = 0; k < 3; ++k)
+    {   //This comparison ensures that sign is taken into account in determining similarity.
+        if ((sum_gesture1[k] >= 0) != (sum_gesture2[k] >= 0))
+        {
+            sign_diff++; //increment if signs don't match. Reduces overall similarity
+        }
+    }
+
+    // normalized Metrics, 1 / (1 + x) in Q15 is 2^30 / (2^15 + x)
+    SimilarityTerms terms;
+    terms.mse = (int32_t)((1u << 30) / (uint32_t)(Q15_ONE + mse));
+    terms.energy = (int32_t)((1u << 30) / (uint32_t)(Q15_ONE + energy_diff));
+    terms.sign = (3 - sign_diff) * Q15_ONE / 3;
+
+    return terms;
+}
+
+int32_t weigh_similarity(const SimilarityTerms &terms, const SimilarityWeights &weights)
+{
+    // Compute Final Similarity, rounded; each product is below 2^30
+    return (weights.mse * terms.mse + weights.energy * terms.energy + weights.sign * terms.sign + (1 << 14)) >> 15;
+}
+
+SimilarityTerms similarity_terms(const Gesture &gesture1, const Gesture &gesture2)
+{
+    return compare(gesture1, gesture2, false);
+}
+
+//This function determines similarity between recorded and unlocking gesture
+int32_t calculate_similarity(const Gesture &gesture1, const Gesture &gesture2)
+{
+    SimilarityTerms terms = compare(gesture1, gesture2, true);
+    int32_t final_similarity = weigh_similarity(terms, SIMILARITY_WEIGHTS);
+
+    telemetry_log(TM_MATCH_TERMS, terms.mse, terms.energy, terms.sign);
+    telemetry_log(TM_MATCH_RESULT, final_similarity);
+
+    return final_similarity;
+}
+
+float reference_similarity(const Gesture &gesture1, const Gesture &gesture2)
+{
+    float energy1 = 0.0f, energy2 = 0.0f;
+    float sum_gesture1[3] = {0.0f}, sum_gesture2[3] = {0.0f};
+    float mse = 0.0f;
+
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            float a = gesture1.axis[j][i] / 32768.0f;
+            float b = gesture2.axis[j][i] / 32768.0f;
+            energy1 += fabsf(a);
+            energy2 += fabsf(b);
+            sum_gesture1[j] += a;
+            sum_gesture2[j] += b;
+            float diff = a - b;
+            mse += diff * diff;
+        }
+    }
+
+    mse /= (SAMPLES * 3);
+
+    float energy_diff = fabsf(energy1 - energy2);
+    int sign_diff = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        if ((sum_gesture1[k] >= 0) != (sum_gesture2[k] >= 0))
+        {
+            sign_diff++;
+        }
+    }
+
+    float normalized_mse = 1.0f / (1.0f + mse);
+    float normalized_energy = 1.0f / (1.0f + energy_diff);
+    float normalized_sign = (3 - sign_diff) / 3.0f;
+
+    return (0.6f * normalized_mse) + (0.3f * normalized_energy) + (0.1f * normalized_sign);
+}
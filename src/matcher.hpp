@@ -0,0 +1,61 @@
+#ifndef MATCHER_HPP
+#define MATCHER_HPP
+
+#include <cstdint>
+
+constexpr int SAMPLES = 30; //number of samples to collect for each gesture
+
+// Q15 fixed point: 32768 represents 1.0. Similarities are returned in Q15
+// as int32 so a perfect score of 1.0 is representable.
+typedef int16_t q15_t;
+
+constexpr int32_t Q15_ONE = 1 << 15;
+
+constexpr int32_t to_q15(double value)
+{
+    return (int32_t)(value * Q15_ONE + (value >= 0 ? 0.5 : -0.5));
+}
+
+constexpr int32_t ACCEPT_THRESHOLD = to_q15(0.8); //similarity above this unlocks
+
+// One gesture in structure-of-arrays layout: each axis is contiguous so the
+// kernels stream through memory and only 180 bytes are needed per template.
+struct Gesture
+{
+    q15_t axis[3][SAMPLES];
+};
+
+// the three normalized comparisons calculate_similarity() blends, each Q15 in [0, 1]
+struct SimilarityTerms
+{
+    int32_t mse;    // 1 / (1 + mean squared error)
+    int32_t energy; // 1 / (1 + |energy difference|)
+    int32_t sign;   // share of axes whose sums agree in sign
+};
+
+// Q15 weight of each term; they add up to Q15_ONE
+struct SimilarityWeights
+{
+    int32_t mse, energy, sign;
+};
+
+// MSE is weighed as 'most important' as it tracks how close the 2 signals are
+// Energy of the signal is considered in addition to MSE
+// Sign is considered minimally to ensure that mirrored gestured don't register as the same.
+constexpr SimilarityWeights SIMILARITY_WEIGHTS = {to_q15(0.6), to_q15(0.3), to_q15(0.1)};
+
+q15_t normalize(int16_t value); //normalizes gyroscope data to Q15 [-1,1)
+
+//calculates the similarity between two gestures, index by index, in Q15
+int32_t calculate_similarity(const Gesture &gesture1, const Gesture &gesture2);
+
+// the same comparison split in two, without telemetry, so an offline
+// evaluation can compute the terms once and try many weightings
+SimilarityTerms similarity_terms(const Gesture &gesture1, const Gesture &gesture2);
+int32_t weigh_similarity(const SimilarityTerms &terms, const SimilarityWeights &weights);
+
+// float implementation of the same metric, kept as the reference the fixed
+// point version is checked against
+float reference_similarity(const Gesture &gesture1, const Gesture &gesture2);
+
+#endif // MATCHER_HPP
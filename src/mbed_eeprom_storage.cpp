@@ -0,0 +1,37 @@
+#include "mbed_eeprom_storage.hpp"
+
+bool MbedEepromStorage::init()
+{
+    ready = eeprom.Init() == EEPROM_OK;
+    return ready;
+}
+
+uint32_t MbedEepromStorage::size() const
+{
+    return SIZE;
+}
+
+uint32_t MbedEepromStorage::page_size() const
+{
+    return PAGE_SIZE;
+}
+
+bool MbedEepromStorage::read(uint32_t addr, uint8_t *buf, size_t len)
+{
+    if (!ready || addr + len > SIZE)
+    {
+        return false;
+    }
+    uint16_t count = (uint16_t)len;
+    return eeprom.ReadBuffer(buf, (uint16_t)addr, &count) == EEPROM_OK;
+}
+
+bool MbedEepromStorage::write(uint32_t addr, const uint8_t *buf, size_t len)
+{
+    if (!ready || addr + len > SIZE)
+    {
+        return false;
+    }
+    // the BSP takes a non-const buffer but only reads from it
+    return eeprom.WriteBuffer(const_cast<uint8_t *>(buf), (uint16_t)addr, (uint16_t)len) == EEPROM_OK;
+}
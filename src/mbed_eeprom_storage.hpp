@@ -0,0 +1,28 @@
+#ifndef MBED_EEPROM_STORAGE_HPP
+#define MBED_EEPROM_STORAGE_HPP
+
+#include "EEPROM_DISCO_F429ZI.h"
+
+#include "storage.hpp"
+
+// M24LR64 I2C EEPROM used by the DISCO-F429ZI BSP: 8 KB, 4-byte pages
+class MbedEepromStorage : public Storage
+{
+private:
+    static const uint32_t SIZE = 8 * 1024;
+    static const uint32_t PAGE_SIZE = 4;
+
+    EEPROM_DISCO_F429ZI eeprom;
+    bool ready = false;
+
+public:
+    bool init();
+
+    uint32_t size() const override;
+    uint32_t page_size() const override;
+
+    bool read(uint32_t addr, uint8_t *buf, size_t len) override;
+    bool write(uint32_t addr, const uint8_t *buf, size_t len) override;
+};
+
+#endif // MBED_EEPROM_STORAGE_HPP
@@ -0,0 +1,537 @@
+#include "mbed.h"
+
+#include <cstring>
+
+#include "mbed_hal.hpp"
+
+void hal_sleep_ms(uint32_t ms)
+{
+    thread_sleep_for(ms);
+}
+
+uint32_t hal_now_ms()
+{
+    return (uint32_t)Kernel::Clock::now().time_since_epoch().count();
+}
+
+static bool deep_sleep_locked = false;
+
+void hal_allow_deep_sleep(bool allowed)
+{
+    // the sleep manager counts locks, so only ever hold one
+    if (allowed && deep_sleep_locked)
+    {
+        sleep_manager_unlock_deep_sleep();
+        deep_sleep_locked = false;
+    }
+    else if (!allowed && !deep_sleep_locked)
+    {
+        sleep_manager_lock_deep_sleep();
+        deep_sleep_locked = true;
+    }
+}
+
+static const uint16_t SCREEN_WIDTH = 240;
+static const uint16_t SCREEN_HEIGHT = 320;
+static const uint32_t BACK_BUFFER_OFFSET = 0x50000; // where the BSP puts the foreground layer
+
+static const uint32_t DMA2D_MODE_M2M = 0;
+static const uint32_t DMA2D_MODE_R2M = DMA2D_CR_MODE_0 | DMA2D_CR_MODE_1;
+static const uint32_t DMA2D_MODE_M2M_BLEND = DMA2D_CR_MODE_1;
+static const uint32_t DMA2D_ARGB8888 = 0;
+static const uint32_t DMA2D_A8 = 0b1001;
+
+// Every printable ASCII glyph of the three fonts as A8 coverage, rasterized
+// from the BSP bitmaps on first use into SDRAM past both frame buffers.
+// DrawText() lays a run out from these and DMA2D blends it in one pass,
+// where the BSP would plot each pixel through a function call.
+static const char FIRST_GLYPH = ' ';
+static const char LAST_GLYPH = '~';
+static const int GLYPHS = LAST_GLYPH - FIRST_GLYPH + 1;
+static const uint32_t GLYPH_CACHE = LCD_FRAME_BUFFER + 2 * BACK_BUFFER_OFFSET;
+static const size_t MAX_RUN = 24; // characters per blend, longer runs are split
+
+static const uint8_t *glyph_sets[3]; // by FontSize, null until rasterized and after a doze
+static uint8_t run_alpha[MAX_RUN * 14 * 20]; // widest run of Font20, in SRAM where DMA2D reads fast
+
+// The strip chart is a ring of columns in a buffer twice the chart's width,
+// every column written at x and again at x + width, so the window the
+// foreground layer scans out is always contiguous: PlotColumn() draws one
+// column and moves the layer's start address one pixel on. Past the glyph
+// cache, which needs less than 64 KiB.
+static const uint32_t PLOT_BUFFER = GLYPH_CACHE + 0x10000;
+
+static uint32_t plot_column[SCREEN_HEIGHT]; // the column being drawn, copied out twice by DMA2D
+
+// Present() sleeps until LTDC has reloaded its shadow registers at the
+// vertical blank; the register reload interrupt wakes it with a thread flag.
+// Bit 30 is MbedSpiBus's, so the two can share a thread.
+static const uint32_t RELOAD_FLAG = 1u << 29;
+static osThreadId_t reload_waiter; // null when nobody waits
+
+static void on_ltdc_irq()
+{
+    LTDC->ICR = LTDC_ICR_CRRIF;
+    osThreadId_t waiter = reload_waiter;
+    if (waiter != nullptr)
+    {
+        osThreadFlagsSet(waiter, RELOAD_FLAG);
+    }
+}
+
+// clips a rectangle to the screen, false when nothing is left
+static bool clip(uint16_t &x, uint16_t &y, uint16_t &width, uint16_t &height)
+{
+    if (x >= SCREEN_WIDTH || y >= SCREEN_HEIGHT || width == 0 || height == 0)
+    {
+        return false;
+    }
+    if (width > SCREEN_WIDTH - x)
+    {
+        width = SCREEN_WIDTH - x;
+    }
+    if (height > SCREEN_HEIGHT - y)
+    {
+        height = SCREEN_HEIGHT - y;
+    }
+    return true;
+}
+
+static uint32_t pixel_offset(uint16_t x, uint16_t y)
+{
+    return ((uint32_t)y * SCREEN_WIDTH + x) * 4;
+}
+
+// `pitch` is the output's line length in pixels
+static void dma2d_run(uint32_t mode, uint16_t width, uint16_t height, uint16_t pitch = SCREEN_WIDTH)
+{
+    DMA2D->OOR = pitch - width;
+    DMA2D->OPFCCR = DMA2D_ARGB8888;
+    DMA2D->NLR = ((uint32_t)width << 16) | height;
+    DMA2D->CR = mode | DMA2D_CR_START;
+    while (DMA2D->CR & DMA2D_CR_START)
+    {
+    }
+}
+
+// register to memory: a solid rectangle without touching the CPU
+static void dma2d_fill(uint32_t frame, uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t color)
+{
+    if (!clip(x, y, width, height))
+    {
+        return;
+    }
+    DMA2D->OCOLR = color;
+    DMA2D->OMAR = frame + pixel_offset(x, y);
+    dma2d_run(DMA2D_MODE_R2M, width, height);
+}
+
+// memory to memory: copies a rectangle between two frames
+static void dma2d_copy(uint32_t from, uint32_t to, Rect area)
+{
+    if (!clip(area.x, area.y, area.width, area.height))
+    {
+        return;
+    }
+    uint32_t offset = pixel_offset(area.x, area.y);
+    DMA2D->FGMAR = from + offset;
+    DMA2D->FGOR = SCREEN_WIDTH - area.width;
+    DMA2D->FGPFCCR = DMA2D_ARGB8888;
+    DMA2D->OMAR = to + offset;
+    dma2d_run(DMA2D_MODE_M2M, area.width, area.height);
+}
+
+static sFONT *bsp_font(FontSize font)
+{
+    switch (font)
+    {
+    case FONT_8:
+        return &Font8;
+    case FONT_16:
+        return &Font16;
+    default:
+        return &Font20;
+    }
+}
+
+// A8 glyphs of `font`, GLYPHS of them back to back, Width x Height each
+static const uint8_t *glyphs(FontSize font)
+{
+    if (glyph_sets[font] != nullptr)
+    {
+        return glyph_sets[font];
+    }
+
+    // the sets follow each other in FontSize order
+    uint8_t *alpha = (uint8_t *)GLYPH_CACHE;
+    for (int f = 0; f < font; ++f)
+    {
+        const sFONT *before = bsp_font((FontSize)f);
+        alpha += GLYPHS * before->Width * before->Height;
+    }
+
+    // BSP rows are (Width + 7) / 8 bytes, most significant bit leftmost
+    const sFONT *bsp = bsp_font(font);
+    int row_bytes = (bsp->Width + 7) / 8;
+    const uint8_t *bits = bsp->table;
+    uint8_t *out = alpha;
+    for (int row = 0; row < GLYPHS * bsp->Height; ++row, bits += row_bytes)
+    {
+        for (int x = 0; x < bsp->Width; ++x)
+        {
+            *out++ = (bits[x / 8] & (0x80 >> (x % 8))) ? 0xFF : 0x00;
+        }
+    }
+
+    glyph_sets[font] = alpha;
+    return alpha;
+}
+
+MbedDisplay::MbedDisplay()
+    : front(LCD_FRAME_BUFFER), back(LCD_FRAME_BUFFER + BACK_BUFFER_OFFSET)
+{
+    __HAL_RCC_DMA2D_CLK_ENABLE();
+
+    // the BSP shows the background layer; the foreground one stays hidden
+    // until there is a chart to show
+    lcd.SetLayerVisible(LCD_FOREGROUND_LAYER, DISABLE);
+    dma2d_fill(back, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, back_color);
+
+    // every reload raises it, the chart's too; only Present() listens
+    LTDC->ICR = LTDC_ICR_CRRIF;
+    LTDC->IER |= LTDC_IER_RRIE;
+    NVIC_SetVector(LTDC_IRQn, (uint32_t)&on_ltdc_irq);
+    NVIC_EnableIRQ(LTDC_IRQn);
+}
+
+uint16_t MbedDisplay::GetXSize()
+{
+    return (uint16_t)lcd.GetXSize();
+}
+
+uint16_t MbedDisplay::GetYSize()
+{
+    return (uint16_t)lcd.GetYSize();
+}
+
+void MbedDisplay::Clear(uint32_t color)
+{
+    dma2d_fill(back, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, color);
+}
+
+void MbedDisplay::SetBackColor(uint32_t color)
+{
+    back_color = color;
+    lcd.SetBackColor(color);
+}
+
+void MbedDisplay::SetTextColor(uint32_t color)
+{
+    text_color = color;
+    lcd.SetTextColor(color);
+}
+
+void MbedDisplay::SetFont(FontSize font)
+{
+    this->font = font;
+    lcd.SetFont(bsp_font(font));
+}
+
+uint16_t MbedDisplay::Line(uint16_t line)
+{
+    return LINE(line);
+}
+
+uint16_t MbedDisplay::CharWidth()
+{
+    return bsp_font(font)->Width;
+}
+
+void MbedDisplay::DisplayStringAt(uint16_t x, uint16_t y, const char *text, TextAlign align)
+{
+    // placed like the BSP places it, in whole cells that fit on the screen
+    int width = bsp_font(font)->Width;
+    int length = (int)strlen(text);
+    int spare = (SCREEN_WIDTH / width - length) * width;
+    int column = x;
+    if (align == ALIGN_CENTER)
+    {
+        column = x + spare / 2;
+    }
+    else if (align == ALIGN_RIGHT)
+    {
+        column = spare - x;
+    }
+    if (column < 0)
+    {
+        column = 0;
+    }
+    if (column >= SCREEN_WIDTH)
+    {
+        return;
+    }
+    int fit = (SCREEN_WIDTH - column) / width;
+    DrawText((uint16_t)column, y, text, (size_t)(length < fit ? length : fit));
+}
+
+void MbedDisplay::DrawText(uint16_t x, uint16_t y, const char *text, size_t length)
+{
+    const sFONT *bsp = bsp_font(font);
+    const uint8_t *alpha = glyphs(font);
+    uint16_t width = bsp->Width;
+    uint16_t height = bsp->Height;
+    size_t glyph_size = (size_t)width * height;
+
+    while (length > 0 && x < SCREEN_WIDTH)
+    {
+        size_t count = length < MAX_RUN ? length : MAX_RUN;
+        uint16_t run_width = (uint16_t)(count * width);
+
+        // the run's coverage, row by row across its glyphs
+        uint8_t *out = run_alpha;
+        for (uint16_t row = 0; row < height; ++row)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                char c = text[i] >= FIRST_GLYPH && text[i] <= LAST_GLYPH ? text[i] : '?';
+                memcpy(out, &alpha[(c - FIRST_GLYPH) * glyph_size + row * width], width);
+                out += width;
+            }
+        }
+
+        uint16_t clip_x = x, clip_y = y, clip_width = run_width, clip_height = height;
+        if (!clip(clip_x, clip_y, clip_width, clip_height))
+        {
+            return;
+        }
+
+        // cells in the back colour, then the glyphs blended over them in the text colour
+        dma2d_fill(back, x, y, clip_width, clip_height, back_color);
+        DMA2D->FGMAR = (uint32_t)run_alpha;
+        DMA2D->FGOR = run_width - clip_width;
+        DMA2D->FGPFCCR = DMA2D_A8;
+        DMA2D->FGCOLR = text_color & 0x00FFFFFF;
+        DMA2D->BGMAR = back + pixel_offset(x, y);
+        DMA2D->BGOR = SCREEN_WIDTH - clip_width;
+        DMA2D->BGPFCCR = DMA2D_ARGB8888;
+        DMA2D->OMAR = back + pixel_offset(x, y);
+        dma2d_run(DMA2D_MODE_M2M_BLEND, clip_width, clip_height);
+
+        text += count;
+        length -= count;
+        x += run_width;
+    }
+}
+
+void MbedDisplay::DisplayStringAtLine(uint16_t line, const char *text)
+{
+    DisplayStringAt(0, Line(line), text, ALIGN_LEFT);
+}
+
+void MbedDisplay::ClearStringLine(uint32_t line)
+{
+    dma2d_fill(back, 0, Line(line), SCREEN_WIDTH, Line(1), back_color);
+}
+
+void MbedDisplay::FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    dma2d_fill(back, x, y, width, height, text_color);
+}
+
+void MbedDisplay::DrawRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+    // the same four edges the BSP draws
+    dma2d_fill(back, x, y, width, 1, text_color);
+    dma2d_fill(back, x, y + height, width, 1, text_color);
+    dma2d_fill(back, x, y, 1, height, text_color);
+    dma2d_fill(back, x + width, y, 1, height, text_color);
+}
+
+void MbedDisplay::Present(const Rect *changed, int count)
+{
+    // latch the back buffer as the visible one at the next vertical blank,
+    // sleeping until then; a chart reload in between may wake us early, and
+    // a flag set before the wait just returns it at once
+    ThisThread::flags_clear(RELOAD_FLAG);
+    reload_waiter = ThisThread::get_id();
+    LTDC_Layer1->CFBAR = back;
+    LTDC->SRCR = LTDC_SRCR_VBR;
+    while (LTDC->SRCR & LTDC_SRCR_VBR)
+    {
+        ThisThread::flags_wait_any(RELOAD_FLAG);
+    }
+    reload_waiter = nullptr;
+
+    uint32_t shown = back;
+    back = front;
+    front = shown;
+
+    // bring the new back buffer up to date so the next frame can be partial
+    if (changed == nullptr)
+    {
+        Rect screen = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+        dma2d_copy(front, back, screen);
+        return;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        dma2d_copy(front, back, changed[i]);
+    }
+}
+
+void MbedDisplay::PlotBegin(Rect area, uint32_t background)
+{
+    if (!clip(area.x, area.y, area.width, area.height))
+    {
+        return;
+    }
+    plot_area = area;
+    plot_background = background;
+    plot_next = 0;
+
+    // both copies of every column empty
+    uint16_t pitch = 2 * area.width;
+    DMA2D->OCOLR = background;
+    DMA2D->OMAR = PLOT_BUFFER;
+    dma2d_run(DMA2D_MODE_R2M, pitch, area.height, pitch);
+
+    // the layer's window over `area`, in active display coordinates that
+    // start after the back porches, scanning `width` of every `pitch` pixels
+    uint32_t hbp = (LTDC->BPCR & LTDC_BPCR_AHBP) >> 16;
+    uint32_t vbp = LTDC->BPCR & LTDC_BPCR_AVBP;
+    LTDC_Layer2->WHPCR = (area.x + hbp + 1) | ((area.x + area.width + hbp) << 16);
+    LTDC_Layer2->WVPCR = (area.y + vbp + 1) | ((area.y + area.height + vbp) << 16);
+    LTDC_Layer2->PFCR = 0; // ARGB8888
+    LTDC_Layer2->CACR = 0xFF;
+    LTDC_Layer2->CFBLR = ((uint32_t)pitch * 4 << 16) | (area.width * 4 + 3);
+    LTDC_Layer2->CFBLNR = area.height;
+    LTDC_Layer2->CFBAR = PLOT_BUFFER;
+    LTDC->SRCR = LTDC_SRCR_VBR;
+}
+
+void MbedDisplay::PlotColumn(const PlotSpan *spans, int count)
+{
+    uint16_t width = plot_area.width;
+    uint16_t height = plot_area.height;
+    if (height == 0)
+    {
+        return;
+    }
+
+    for (uint16_t y = 0; y < height; ++y)
+    {
+        plot_column[y] = plot_background;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        uint16_t bottom = spans[i].bottom < height ? spans[i].bottom : height - 1;
+        for (uint16_t y = spans[i].top; y <= bottom; ++y)
+        {
+            plot_column[y] = spans[i].color;
+        }
+    }
+
+    // one pixel per line into both copies of the column
+    uint16_t pitch = 2 * width;
+    uint32_t copies[2] = {plot_next, (uint32_t)plot_next + width};
+    for (uint32_t x : copies)
+    {
+        DMA2D->FGMAR = (uint32_t)plot_column;
+        DMA2D->FGOR = 0;
+        DMA2D->FGPFCCR = DMA2D_ARGB8888;
+        DMA2D->OMAR = PLOT_BUFFER + x * 4;
+        dma2d_run(DMA2D_MODE_M2M, 1, height, pitch);
+    }
+
+    // the window now ends at the new column; latched at the next vertical
+    // blank without waiting for it, several columns a frame just skip ahead
+    plot_next = plot_next + 1 == width ? 0 : plot_next + 1;
+    LTDC_Layer2->CFBAR = PLOT_BUFFER + (uint32_t)plot_next * 4;
+    LTDC->SRCR = LTDC_SRCR_VBR;
+}
+
+void MbedDisplay::PlotShow(bool visible)
+{
+    if (visible)
+    {
+        LTDC_Layer2->CR |= LTDC_LxCR_LEN;
+    }
+    else
+    {
+        LTDC_Layer2->CR &= ~LTDC_LxCR_LEN;
+    }
+    LTDC->SRCR = LTDC_SRCR_VBR;
+}
+
+void MbedDisplay::DisplayOn()
+{
+    // the glyph cache lives in SDRAM like the frame buffers and may not have
+    // survived STOP either, so it is rasterized again on first use
+    for (const uint8_t *&set : glyph_sets)
+    {
+        set = nullptr;
+    }
+    lcd.DisplayOn();
+}
+
+void MbedDisplay::DisplayOff()
+{
+    // LTDC stops scanning out, so STOP mode may also stop the SDRAM refresh
+    lcd.DisplayOff();
+}
+
+bool MbedTouch::Init(uint16_t width, uint16_t height)
+{
+    return ts.Init(width, height) == TS_OK;
+}
+
+void MbedTouch::GetState(TouchState *state)
+{
+    TS_StateTypeDef TS_State;
+    ts.GetState(&TS_State); //read touchscreen state
+    state->touched = TS_State.TouchDetected != 0;
+    state->x = TS_State.X;
+    state->y = TS_State.Y;
+}
+
+bool MbedTouch::AttachInterrupt(EventHandler handler, void *context)
+{
+    // touch detect interrupts on both contact and release, active low
+    if (ts.ITConfig() != TS_OK)
+    {
+        return false;
+    }
+    irq.mode(PullUp);
+    irq.fall(callback(handler, context));
+    return true;
+}
+
+void MbedTouch::ClearInterrupt()
+{
+    ts.ITClear();
+}
+
+int MbedEventLoop::call_in(uint32_t ms, EventHandler handler, void *context)
+{
+    return queue.call_in(std::chrono::milliseconds(ms), handler, context);
+}
+
+int MbedEventLoop::call_every(uint32_t ms, EventHandler handler, void *context)
+{
+    return queue.call_every(std::chrono::milliseconds(ms), handler, context);
+}
+
+void MbedEventLoop::cancel(int id)
+{
+    queue.cancel(id);
+}
+
+void MbedEventLoop::dispatch_for(uint32_t ms)
+{
+    queue.dispatch_for(std::chrono::milliseconds(ms));
+}
+
+void MbedEventLoop::dispatch_forever()
+{
+    queue.dispatch_forever();
+}
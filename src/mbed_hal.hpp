@@ -0,0 +1,90 @@
+#ifndef MBED_HAL_HPP
+#define MBED_HAL_HPP
+
+#include "mbed.h"
+
+#include "LCD_DISCO_F429ZI.h"
+#include "TS_DISCO_F429ZI.h"
+
+#include "hal.hpp"
+
+// ILI9341 panel through the BSP LCD driver, double buffered: the background
+// layer scans out the front buffer while everything is drawn into the back
+// buffer with DMA2D, text from glyphs rasterized once into SDRAM. The
+// foreground layer is left to the strip chart.
+class MbedDisplay : public Display
+{
+private:
+    LCD_DISCO_F429ZI lcd;
+
+    uint32_t front; // SDRAM address LTDC is showing
+    uint32_t back;  // SDRAM address being drawn
+    uint32_t text_color = 0xFFFFFFFF;
+    uint32_t back_color = 0xFF000000;
+    FontSize font = FONT_20;
+
+    Rect plot_area = {}; // the chart's window on the screen
+    uint32_t plot_background = 0xFF000000;
+    uint16_t plot_next = 0; // ring column the next PlotColumn() writes
+
+public:
+    MbedDisplay();
+
+    uint16_t GetXSize() override;
+    uint16_t GetYSize() override;
+
+    void Clear(uint32_t color) override;
+    void SetBackColor(uint32_t color) override;
+    void SetTextColor(uint32_t color) override;
+    void SetFont(FontSize font) override;
+    uint16_t Line(uint16_t line) override;
+    uint16_t CharWidth() override;
+
+    void DisplayStringAt(uint16_t x, uint16_t y, const char *text, TextAlign align) override;
+    void DrawText(uint16_t x, uint16_t y, const char *text, size_t length) override;
+    void DisplayStringAtLine(uint16_t line, const char *text) override;
+    void ClearStringLine(uint32_t line) override;
+
+    void FillRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) override;
+    void DrawRect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) override;
+
+    void Present(const Rect *changed, int count) override;
+
+    void PlotBegin(Rect area, uint32_t background) override;
+    void PlotColumn(const PlotSpan *spans, int count) override;
+    void PlotShow(bool visible) override;
+
+    void DisplayOn() override;
+    void DisplayOff() override;
+};
+
+// STMPE811 resistive touch controller, its open-drain INT on PA15
+class MbedTouch : public Touch
+{
+private:
+    TS_DISCO_F429ZI ts;
+    InterruptIn irq{PA_15};
+
+public:
+    bool Init(uint16_t width, uint16_t height) override;
+    void GetState(TouchState *state) override;
+    bool AttachInterrupt(EventHandler handler, void *context) override;
+    void ClearInterrupt() override;
+};
+
+// mbed EventQueue, dispatched by the main thread
+class MbedEventLoop : public EventLoop
+{
+private:
+    EventQueue queue{32 * EVENTS_EVENT_SIZE};
+
+public:
+    int call_in(uint32_t ms, EventHandler handler, void *context) override;
+    int call_every(uint32_t ms, EventHandler handler, void *context) override;
+    void cancel(int id) override;
+    void dispatch_for(uint32_t ms) override;
+
+    void dispatch_forever();
+};
+
+#endif // MBED_HAL_HPP
@@ -0,0 +1,28 @@
+#include "mbed.h"
+
+#include "profiler.hpp"
+
+#if PROFILING_ENABLED
+
+static uint32_t ticks_per_us = 1;
+
+// DWT cycle counter: one tick per core clock, wraps after ~23 s at 180 MHz
+void profile_clock_init()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    ticks_per_us = SystemCoreClock / 1000000;
+}
+
+uint32_t profile_ticks()
+{
+    return DWT->CYCCNT;
+}
+
+uint32_t profile_ticks_to_us(uint32_t ticks)
+{
+    return ticks / ticks_per_us;
+}
+
+#endif // PROFILING_ENABLED
@@ -0,0 +1,88 @@
+#include "mbed.h"
+
+#include "sampler.hpp"
+
+static const uint32_t WATERMARK_FLAG = 1;
+static const uint32_t SUSPEND_FLAG = 2;
+static const uint32_t SUSPENDED_FLAG = 4;
+static const uint32_t RESUME_FLAG = 8;
+static const uint32_t FIFO_READ_FLAG = 16;
+
+static InterruptIn gyro_int2(PA_2); // L3GD20 INT2/DRDY, high while the FIFO is at or above the watermark
+static EventFlags sampler_flags;
+static Thread sampler_thread(osPriorityRealtime, 2048, nullptr, "sampler");
+static volatile uint32_t watermark_timestamp_us = 0;
+
+static void on_watermark()
+{
+    watermark_timestamp_us = us_ticker_read();
+    sampler_flags.set(WATERMARK_FLAG);
+}
+
+bool Sampler::start(uint8_t level)
+{
+    watermark = level;
+    nominal_interval_us = (uint32_t)watermark * 1'000'000 / ODR_HZ;
+
+    gyro_int2.rise(on_watermark);
+    if (!gyro.enable_fifo(watermark))
+    {
+        return false;
+    }
+
+    return sampler_thread.start(callback(this, &Sampler::run)) == osOK;
+}
+
+// SPI completion interrupt: the burst is in
+static void on_fifo_read(void *)
+{
+    sampler_flags.set(FIFO_READ_FLAG);
+}
+
+void Sampler::drain(uint32_t timestamp_us)
+{
+    // the status read chains into the burst without waking this thread
+    gyro.read_fifo_async(on_fifo_read, nullptr);
+    sampler_flags.wait_any(FIFO_READ_FLAG);
+    collect(timestamp_us);
+}
+
+void Sampler::suspend()
+{
+    sampler_flags.set(SUSPEND_FLAG);
+    sampler_flags.wait_any(SUSPENDED_FLAG); // the thread has let go of the gyro
+}
+
+bool Sampler::resume()
+{
+    resumed = true;
+    if (!gyro.enable_fifo(watermark))
+    {
+        return false;
+    }
+    sampler_flags.set(RESUME_FLAG);
+    return true;
+}
+
+void Sampler::run()
+{
+    const auto timeout = std::chrono::milliseconds(2 * nominal_interval_us / 1000 + 1);
+
+    while (true)
+    {
+        // INT2 is level based, so an edge that fired before rise() was attached
+        // would never repeat; the timeout catches that case.
+        uint32_t flags = sampler_flags.wait_any_for(WATERMARK_FLAG | SUSPEND_FLAG, timeout);
+        if (!(flags & osFlagsError) && (flags & SUSPEND_FLAG))
+        {
+            // no timeout while suspended: this thread must not wake the MCU
+            gyro.disable_fifo();
+            sampler_flags.set(SUSPENDED_FLAG);
+            sampler_flags.wait_any(RESUME_FLAG);
+            continue;
+        }
+        uint32_t timestamp = (flags & osFlagsError) ? us_ticker_read() : watermark_timestamp_us;
+
+        drain(timestamp);
+    }
+}
@@ -0,0 +1,83 @@
+#include "mbed_spi_bus.hpp"
+
+MbedSpiBus::MbedSpiBus() : spi(PF_9, PF_8, PF_7, PC_1, use_gpio_ssel)
+{
+    // SPI:
+    // - 8-bit data size
+    // - Mode 3 (CPOL = 1, CPHA = 1): idle clock high, data sampled on falling edge
+    spi.format(8, 3);
+
+    // Set SPI communication frequency to 1 MHz
+    spi.frequency(1'000'000);
+}
+
+void MbedSpiBus::submit(SpiTransaction &t)
+{
+    t.next = nullptr;
+
+    core_util_critical_section_enter();
+    bool idle = head == nullptr;
+    if (idle)
+    {
+        head = &t;
+    }
+    else
+    {
+        tail->next = &t;
+    }
+    tail = &t;
+    core_util_critical_section_exit();
+
+    // otherwise the completion of the one ahead starts it
+    if (idle)
+    {
+        start(t);
+    }
+}
+
+void MbedSpiBus::start(SpiTransaction &t)
+{
+    spi.transfer(t.tx, (int)t.len, t.rx, (int)t.len, callback(this, &MbedSpiBus::on_complete), SPI_EVENT_ALL);
+}
+
+void MbedSpiBus::on_complete(int event)
+{
+    // an error or overflow ends the transfer too; the queue moves on either
+    // way and the owner learns about it from `failed`
+    core_util_critical_section_enter();
+    SpiTransaction *done = head;
+    SpiTransaction *next = done->next;
+    head = next;
+    if (next == nullptr)
+    {
+        tail = nullptr;
+    }
+    core_util_critical_section_exit();
+
+    done->failed = (event & (SPI_EVENT_ERROR | SPI_EVENT_RX_OVERFLOW)) != 0;
+
+    // keep the bus busy before handing the result back. Only `next` is ours
+    // to start: once the queue ran empty, a submit() from an interrupt may
+    // already have made itself the head and started it.
+    if (next != nullptr)
+    {
+        start(*next);
+    }
+    if (done->done)
+    {
+        done->done(done->context);
+    }
+}
+
+void MbedSpiBus::wake_waiter(void *thread)
+{
+    osThreadFlagsSet((osThreadId_t)thread, SPI_DONE_FLAG);
+}
+
+void MbedSpiBus::transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+    // the flag is per thread, so concurrent callers never wake each other
+    SpiTransaction t = {tx, rx, len, wake_waiter, ThisThread::get_id(), nullptr, false};
+    submit(t);
+    ThisThread::flags_wait_all(SPI_DONE_FLAG);
+}
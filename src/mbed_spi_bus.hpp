@@ -0,0 +1,32 @@
+#ifndef MBED_SPI_BUS_HPP
+#define MBED_SPI_BUS_HPP
+
+#include "mbed.h"
+#include "spi_bus.hpp"
+
+// SPI5 on the DISCO-F429ZI, wired to the onboard L3GD20. Transactions are
+// kept in an intrusive queue and started back to back from the completion
+// interrupt, so the bus never waits for a thread to be scheduled.
+class MbedSpiBus : public SpiBus
+{
+private:
+    static const uint32_t SPI_DONE_FLAG = 1u << 30; // thread flag of a blocking transfer()
+
+    SPI spi;
+
+    SpiTransaction *head = nullptr; // in flight
+    SpiTransaction *tail = nullptr;
+
+    void start(SpiTransaction &t);
+    void on_complete(int event);
+
+    static void wake_waiter(void *thread);
+
+public:
+    MbedSpiBus();
+
+    void submit(SpiTransaction &t) override;
+    void transfer(const uint8_t *tx, uint8_t *rx, size_t len) override;
+};
+
+#endif // MBED_SPI_BUS_HPP
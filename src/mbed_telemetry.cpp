@@ -0,0 +1,50 @@
+#include "mbed.h"
+
+#include "telemetry.hpp"
+
+static const uint32_t TELEMETRY_BAUD = 115200; // ~3x the full-ODR sample stream
+static const auto IDLE_POLL = 10ms;
+static const auto LOW_POWER_POLL = 1s; // dozing: a few frames a second at most
+
+static BufferedSerial telemetry_uart(USBTX, USBRX, TELEMETRY_BAUD);
+static Thread telemetry_thread(osPriorityLow, 1024, nullptr, "telemetry");
+
+// only runs when nothing else wants the CPU; the UART write may block here
+// without delaying sampling or the UI
+static void drain()
+{
+    static uint8_t buf[TELEMETRY_MAX_FRAME * 2];
+    bool listening = true;
+
+    while (true)
+    {
+        // a receiver that is enabled holds a deep sleep lock
+        bool low_power = telemetry_low_power();
+        if (listening == low_power)
+        {
+            listening = !low_power;
+            telemetry_uart.enable_input(listening);
+        }
+
+        uint8_t command;
+        if (listening && telemetry_uart.readable() && telemetry_uart.read(&command, 1) == 1)
+        {
+            telemetry_post_command(command);
+        }
+
+        size_t len = telemetry_drain(buf, sizeof(buf));
+        if (len > 0)
+        {
+            telemetry_uart.write(buf, len);
+        }
+        else
+        {
+            ThisThread::sleep_for(low_power ? LOW_POWER_POLL : IDLE_POLL);
+        }
+    }
+}
+
+void telemetry_start()
+{
+    telemetry_thread.start(drain);
+}
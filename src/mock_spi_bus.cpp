@@ -0,0 +1,173 @@
+#include "mock_spi_bus.hpp"
+
+#include <cstring>
+
+MockSpiBus::MockSpiBus()
+{
+    memset(regs, 0, sizeof(regs));
+    memset(fifo, 0, sizeof(fifo));
+    memset(output, 0, sizeof(output));
+    regs[WHO_AM_I] = 0xD4;
+}
+
+bool MockSpiBus::fifo_enabled() const
+{
+    return (regs[CTRL_REG5] & 0x40) != 0;
+}
+
+uint8_t MockSpiBus::fifo_mode() const
+{
+    return regs[FIFO_CTRL_REG] >> 5;
+}
+
+uint8_t MockSpiBus::reg(uint8_t addr) const
+{
+    return regs[addr & 0x3F];
+}
+
+int MockSpiBus::level() const
+{
+    return fifo_count;
+}
+
+MockSpiBus::Power MockSpiBus::power() const
+{
+    uint8_t reg1 = regs[CTRL_REG1];
+    if (!(reg1 & 0x08))
+    {
+        return POWER_DOWN;
+    }
+    return (reg1 & 0x07) ? NORMAL : SLEEP;
+}
+
+void MockSpiBus::push_sample(int16_t x, int16_t y, int16_t z)
+{
+    if (power() != NORMAL)
+    {
+        return; // the sample was never measured
+    }
+
+    if (!fifo_enabled() || fifo_mode() == 0)
+    {
+        // bypass: only the output registers are updated
+        output[0] = x;
+        output[1] = y;
+        output[2] = z;
+        return;
+    }
+
+    if (fifo_count == FIFO_DEPTH)
+    {
+        // stream mode drops the oldest sample
+        fifo_head = (fifo_head + 1) % FIFO_DEPTH;
+        fifo_count--;
+        fifo_overrun = true;
+    }
+
+    int tail = (fifo_head + fifo_count) % FIFO_DEPTH;
+    fifo[tail][0] = x;
+    fifo[tail][1] = y;
+    fifo[tail][2] = z;
+    fifo_count++;
+}
+
+void MockSpiBus::pop_sample()
+{
+    if (fifo_count == 0)
+    {
+        return;
+    }
+    // the output registers keep the last sample once the FIFO runs dry
+    memcpy(output, fifo[fifo_head], sizeof(output));
+    fifo_head = (fifo_head + 1) % FIFO_DEPTH;
+    fifo_count--;
+    fifo_overrun = false;
+}
+
+uint8_t MockSpiBus::read_byte(uint8_t reg)
+{
+    if (reg >= OUT_X_L && reg <= OUT_Z_H)
+    {
+        int axis = (reg - OUT_X_L) / 2;
+        uint16_t value = (uint16_t)(fifo_count > 0 ? fifo[fifo_head][axis] : output[axis]);
+        return (reg & 1) ? (uint8_t)(value >> 8) : (uint8_t)(value & 0xFF);
+    }
+
+    if (reg == FIFO_SRC_REG)
+    {
+        int unread = fifo_count;
+        uint8_t src = (uint8_t)(unread >= FIFO_DEPTH ? FIFO_DEPTH - 1 : unread);
+        if (unread >= (regs[FIFO_CTRL_REG] & 0x1F) && unread > 0)
+        {
+            src |= 0x80;
+        }
+        if (fifo_overrun || unread >= FIFO_DEPTH)
+        {
+            src |= 0x40;
+        }
+        if (unread == 0)
+        {
+            src |= 0x20;
+        }
+        return src;
+    }
+
+    return regs[reg];
+}
+
+void MockSpiBus::submit(SpiTransaction &t)
+{
+    transfer(t.tx, t.rx, t.len);
+    t.failed = (fail_mask & 1) != 0;
+    fail_mask >>= 1;
+    if (t.done)
+    {
+        t.done(t.context);
+    }
+}
+
+void MockSpiBus::transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+{
+    transactions++;
+    bytes_transferred += len;
+
+    if (len == 0)
+    {
+        return;
+    }
+
+    bool read = (tx[0] & 0x80) != 0;
+    bool increment = (tx[0] & 0x40) != 0;
+    uint8_t addr = tx[0] & 0x3F;
+
+    rx[0] = 0xFF;
+    for (size_t i = 1; i < len; ++i)
+    {
+        if (read)
+        {
+            rx[i] = read_byte(addr);
+        }
+        else
+        {
+            regs[addr] = tx[i];
+            rx[i] = 0xFF;
+        }
+
+        if (!increment)
+        {
+            continue;
+        }
+
+        if (read && addr == OUT_Z_H)
+        {
+            // a completed X/Y/Z triplet retires the FIFO slot
+            pop_sample();
+            if (fifo_enabled())
+            {
+                addr = OUT_X_L;
+                continue;
+            }
+        }
+        addr = (addr + 1) & 0x3F;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef MOCK_SPI_BUS_HPP
+#define MOCK_SPI_BUS_HPP
+
+#include "spi_bus.hpp"
+
+// Register-level model of the L3GD20 for host builds. It understands the
+// read/auto-increment bits, the 32-entry FIFO in bypass and stream mode and
+// the OUT_Z_H -> OUT_X_L wrap-around used for burst reads. No new samples
+// come out unless CTRL_REG1 has the sensor powered with its axes enabled.
+// Transfers complete immediately, so submit() calls `done` before returning.
+class MockSpiBus : public SpiBus
+{
+private:
+    static const uint8_t WHO_AM_I = 0x0F;
+    static const uint8_t CTRL_REG1 = 0x20;
+    static const uint8_t CTRL_REG5 = 0x24;
+    static const uint8_t OUT_X_L = 0x28;
+    static const uint8_t OUT_Z_H = 0x2D;
+    static const uint8_t FIFO_CTRL_REG = 0x2E;
+    static const uint8_t FIFO_SRC_REG = 0x2F;
+
+    static const int FIFO_DEPTH = 32;
+
+    uint8_t regs[0x40];
+
+    int16_t fifo[FIFO_DEPTH][3];
+    int16_t output[3]; // what OUT_X_L..OUT_Z_H show when the FIFO is empty
+    int fifo_head = 0; // oldest sample
+    int fifo_count = 0;
+    bool fifo_overrun = false;
+
+    bool fifo_enabled() const;
+    uint8_t fifo_mode() const;
+    uint8_t read_byte(uint8_t reg);
+    void pop_sample();
+
+public:
+    enum Power
+    {
+        POWER_DOWN,
+        SLEEP,
+        NORMAL
+    };
+
+    // number of transfer() calls, i.e. chip-select assertions
+    unsigned transactions = 0;
+    unsigned bytes_transferred = 0;
+
+    // bit n set: the (n + 1)th submit() from now goes through but reports
+    // `failed`, like an overflow on the real bus
+    unsigned fail_mask = 0;
+
+    MockSpiBus();
+
+    // feeds one sensor sample as if the ODR clock had ticked
+    void push_sample(int16_t x, int16_t y, int16_t z);
+
+    uint8_t reg(uint8_t addr) const;
+    int level() const;
+    Power power() const; // what CTRL_REG1 selects, for the energy model
+
+    void submit(SpiTransaction &t) override;
+    void transfer(const uint8_t *tx, uint8_t *rx, size_t len) override;
+};
+
+#endif // MOCK_SPI_BUS_HPP
@@ -0,0 +1,136 @@
+#include "power_manager.hpp"
+
+#include <cstdlib>
+
+#include "profiler.hpp"
+#include "telemetry.hpp"
+
+PowerManager::PowerManager(Gyro &gyro, Sampler &sampler, Display &display, EventLoop &events)
+    : gyro(gyro), sampler(sampler), display(display), events(events)
+{
+}
+
+void PowerManager::set_wake_handler(EventHandler handler, void *context)
+{
+    wake_handler = handler;
+    wake_context = context;
+}
+
+PowerManager::Mode PowerManager::mode() const
+{
+    return current;
+}
+
+bool PowerManager::moving(const GyroData &sample)
+{
+    return abs(sample.x_raw) > MOTION_THRESHOLD || abs(sample.y_raw) > MOTION_THRESHOLD ||
+           abs(sample.z_raw) > MOTION_THRESHOLD;
+}
+
+void PowerManager::doze()
+{
+    if (current != ACTIVE)
+    {
+        return;
+    }
+
+    // from here on this thread owns the gyro
+    sampler.suspend();
+    gyro.set_power(GYRO_SLEEP);
+    display.DisplayOff();
+    telemetry_set_low_power(true);
+    hal_allow_deep_sleep(true);
+
+    current = DOZING;
+    dozed_at_ms = hal_now_ms();
+    waking = false;
+    check_event = events.call_every(MOTION_CHECK_MS, on_check, this);
+    standby_event = events.call_in(STANDBY_AFTER_MS, on_standby, this);
+}
+
+void PowerManager::wake(WakeSource source)
+{
+    if (current == ACTIVE)
+    {
+        return;
+    }
+
+    PROFILE_START(PROF_WAKE);
+    woken_at_ms = hal_now_ms();
+    woken_by = source;
+    waking = true;
+
+    cancel_checks();
+    hal_allow_deep_sleep(false);
+    telemetry_set_low_power(false);
+    gyro.set_power(GYRO_NORMAL);
+    if (!sampler.resume())
+    {
+        telemetry_log(TM_SAMPLER_START_FAILED);
+    }
+    display.DisplayOn();
+    current = ACTIVE;
+
+    if (wake_handler)
+    {
+        wake_handler(wake_context);
+    }
+}
+
+void PowerManager::samples_arrived()
+{
+    if (!waking)
+    {
+        return;
+    }
+    waking = false;
+    PROFILE_STOP(PROF_WAKE);
+    telemetry_log(TM_WAKE, woken_by, (int32_t)(hal_now_ms() - woken_at_ms), (int32_t)(woken_at_ms - dozed_at_ms));
+}
+
+void PowerManager::on_check(void *power)
+{
+    PowerManager &self = *static_cast<PowerManager *>(power);
+
+    // the sleeping gyro keeps its clock, so a few samples are enough to settle
+    self.gyro.set_power(GYRO_NORMAL);
+    self.settle_event = self.events.call_in(MOTION_SETTLE_MS, on_settled, power);
+}
+
+void PowerManager::on_settled(void *power)
+{
+    PowerManager &self = *static_cast<PowerManager *>(power);
+    self.settle_event = 0;
+
+    // the FIFO is off, so this is the newest sample
+    if (moving(self.gyro.read_gyro()))
+    {
+        self.wake(WAKE_MOTION);
+        return;
+    }
+    self.gyro.set_power(GYRO_SLEEP);
+}
+
+void PowerManager::on_standby(void *power)
+{
+    PowerManager &self = *static_cast<PowerManager *>(power);
+    self.standby_event = 0;
+
+    self.cancel_checks();
+    self.gyro.set_power(GYRO_POWER_DOWN);
+    self.current = STANDBY;
+    telemetry_log(TM_STANDBY, (int32_t)(hal_now_ms() - self.dozed_at_ms));
+}
+
+void PowerManager::cancel_checks()
+{
+    int *pending[] = {&check_event, &settle_event, &standby_event};
+    for (int *event : pending)
+    {
+        if (*event != 0)
+        {
+            events.cancel(*event);
+            *event = 0;
+        }
+    }
+}
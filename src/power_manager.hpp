@@ -0,0 +1,89 @@
+#ifndef POWER_MANAGER_HPP
+#define POWER_MANAGER_HPP
+
+#include <cstdint>
+
+#include "gyroscope.hpp"
+#include "hal.hpp"
+#include "sampler.hpp"
+
+// indexed by TM_WAKE's first argument: append only
+enum WakeSource
+{
+    WAKE_TOUCH,
+    WAKE_MOTION,
+    WAKE_SOURCE_COUNT
+};
+
+// Duty-cycled low power for the time nobody is using the board. Dozing
+// suspends the sampler, puts the gyro to sleep, turns the display off and
+// lets the MCU deep sleep between events. Every MOTION_CHECK_MS the gyro is
+// switched on just long enough for one sample, and a rate above
+// MOTION_THRESHOLD wakes everything up again, as does any touch. After
+// STANDBY_AFTER_MS of dozing the checks stop and the gyro powers down, and
+// from then on only a touch wakes the board.
+//
+// Waking takes the worst of MOTION_CHECK_MS + MOTION_SETTLE_MS for motion
+// and one FIFO watermark for either source until samples flow at the full
+// ODR again. That span is timed as PROF_WAKE and logged as TM_WAKE.
+//
+// Runs on the event loop; the application decides when to doze and is told
+// through the wake handler when to resume its own work.
+class PowerManager
+{
+public:
+    static const uint32_t MOTION_CHECK_MS = 250;
+    static const uint32_t MOTION_SETTLE_MS = 15; // sleep to normal mode, a few samples at 200 Hz
+    static const uint32_t STANDBY_AFTER_MS = 10 * 60 * 1000;
+    static constexpr int32_t MOTION_THRESHOLD = GyroConfig::counts(20000); // 20 dps on any axis
+
+    enum Mode
+    {
+        ACTIVE,  //full-rate sampling, display on
+        DOZING,  //gyro asleep, checked for motion every MOTION_CHECK_MS
+        STANDBY  //gyro powered down, only a touch wakes
+    };
+
+    PowerManager(Gyro &gyro, Sampler &sampler, Display &display, EventLoop &events);
+
+    // called from the event loop once the hardware is running again
+    void set_wake_handler(EventHandler handler, void *context);
+
+    void doze();
+    void wake(WakeSource source);
+
+    // the application saw samples arrive; ends a pending wake measurement
+    void samples_arrived();
+
+    Mode mode() const;
+
+    // a rate worth waking up, or staying awake, for
+    static bool moving(const GyroData &sample);
+
+private:
+    Gyro &gyro;
+    Sampler &sampler;
+    Display &display;
+    EventLoop &events;
+
+    EventHandler wake_handler = nullptr;
+    void *wake_context = nullptr;
+
+    Mode current = ACTIVE;
+    int check_event = 0;   //periodic motion check, 0 when none
+    int settle_event = 0;  //pending motion sample, 0 when none
+    int standby_event = 0; //pending power-down, 0 when none
+
+    uint32_t dozed_at_ms = 0;
+    uint32_t woken_at_ms = 0;
+    WakeSource woken_by = WAKE_TOUCH;
+    bool waking = false; //woken but no full-rate sample seen yet
+
+    static void on_check(void *power);
+    static void on_settled(void *power);
+    static void on_standby(void *power);
+
+    void cancel_checks();
+};
+
+#endif // POWER_MANAGER_HPP
@@ -0,0 +1,129 @@
+#include "profiler.hpp"
+
+#if PROFILING_ENABLED
+
+#include "telemetry.hpp"
+
+static LatencyHistogram histograms[PROF_STAGE_COUNT];
+static uint32_t span_start[PROF_STAGE_COUNT];
+static bool span_open[PROF_STAGE_COUNT];
+
+int LatencyHistogram::bucket_of(uint32_t us)
+{
+    if (us < SUB_BUCKETS)
+    {
+        return (int)us;
+    }
+    int octave = 31 - __builtin_clz(us); // >= 2
+    int sub = (int)(us >> (octave - 2)) & (SUB_BUCKETS - 1);
+    int bucket = SUB_BUCKETS + (octave - 2) * SUB_BUCKETS + sub;
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint32_t LatencyHistogram::bucket_limit(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return (uint32_t)bucket;
+    }
+    int octave = (bucket - SUB_BUCKETS) / SUB_BUCKETS + 2;
+    uint32_t sub = (uint32_t)((bucket - SUB_BUCKETS) % SUB_BUCKETS);
+    uint64_t next = (uint64_t)(SUB_BUCKETS + sub + 1) << (octave - 2);
+    return next > UINT32_MAX ? UINT32_MAX : (uint32_t)(next - 1);
+}
+
+void LatencyHistogram::add(uint32_t us)
+{
+    buckets[bucket_of(us)]++;
+    samples++;
+    if (us > largest)
+    {
+        largest = us;
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        buckets[i] = 0;
+    }
+    samples = 0;
+    largest = 0;
+}
+
+uint32_t LatencyHistogram::count() const
+{
+    return samples;
+}
+
+uint32_t LatencyHistogram::max() const
+{
+    return largest;
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t percent) const
+{
+    if (samples == 0)
+    {
+        return 0;
+    }
+    // rank of the sample that is the percentile, 1 based
+    uint32_t rank = (uint32_t)(((uint64_t)samples * percent + 99) / 100);
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+        {
+            uint32_t limit = bucket_limit(i);
+            return limit < largest ? limit : largest;
+        }
+    }
+    return largest;
+}
+
+void profile_record(ProfileStage stage, uint32_t us)
+{
+    histograms[stage].add(us);
+}
+
+void profile_start(ProfileStage stage)
+{
+    span_start[stage] = profile_ticks();
+    span_open[stage] = true;
+}
+
+void profile_stop(ProfileStage stage)
+{
+    if (span_open[stage])
+    {
+        span_open[stage] = false;
+        profile_record(stage, profile_ticks_to_us(profile_ticks() - span_start[stage]));
+    }
+}
+
+const LatencyHistogram &profile_histogram(ProfileStage stage)
+{
+    return histograms[stage];
+}
+
+void profile_report()
+{
+    for (int i = 0; i < PROF_STAGE_COUNT; ++i)
+    {
+        const LatencyHistogram &histogram = histograms[i];
+        if (histogram.count() > 0)
+        {
+            telemetry_log(TM_PROFILE_STAGE, i, (int32_t)histogram.count(), (int32_t)histogram.max());
+            telemetry_log(TM_PROFILE_PERCENTILES, i, (int32_t)histogram.percentile(50),
+                          (int32_t)histogram.percentile(99));
+        }
+    }
+}
+
+#endif // PROFILING_ENABLED
@@ -0,0 +1,119 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+
+// Per-stage latency histograms. PROFILE_SCOPE times the rest of the enclosing
+// block; PROFILE_START/PROFILE_STOP time a span that crosses ticks, such as
+// touch to verdict. Timestamps come from the DWT cycle counter on the target
+// and std::chrono on the host, and durations are binned in microseconds.
+//
+// Build with -DPROFILING_ENABLED=0 and every macro expands to nothing and no
+// histogram is linked.
+//
+// Each stage must be timed from a single thread. PROFILE_REPORT() may run on
+// another one and then reads counts that are at most one sample stale.
+
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED 1
+#endif
+
+// reported by index over telemetry: append only, never reorder
+enum ProfileStage : uint8_t
+{
+    PROF_SPI_BURST,       // one FIFO burst read
+    PROF_TOUCH_POLL,      // touch controller state read
+    PROF_DISPLAY_XYZ,     // formatting the live values
+    PROF_RESAMPLE,        // segmented gesture to SAMPLES normalized points
+    PROF_MATCH,           // template load and similarity
+    PROF_RENDER,          // painting and presenting changed widgets
+    PROF_UI_TICK,         // a whole UI tick
+    PROF_TOUCH_TO_VERDICT, // Unlock press to the verdict on screen
+    PROF_FILTER,          // low-pass and decimation of one block
+    PROF_WAKE,            // wake trigger to the first full-rate samples
+    PROF_VERDICT,         // last sample of an unlock gesture to the verdict on screen
+    PROF_PLOT,            // one strip chart column
+    PROF_SPOT,            // one sample through the always-on spotter
+    PROF_STAGE_COUNT
+};
+
+#if PROFILING_ENABLED
+
+// Log-linear buckets: values below 4 us are exact, above that every octave
+// is split in four, so a percentile is within 25% up to ~67 s.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKETS = 4;
+    static const int OCTAVES = 24;
+    static const int BUCKETS = SUB_BUCKETS + OCTAVES * SUB_BUCKETS;
+
+    void add(uint32_t us);
+    void reset();
+
+    uint32_t count() const;
+    uint32_t max() const;
+
+    // upper edge of the bucket holding the given percentile, capped at the
+    // largest value seen; 0 when empty
+    uint32_t percentile(uint32_t percent) const;
+
+private:
+    uint32_t buckets[BUCKETS] = {};
+    uint32_t samples = 0;
+    uint32_t largest = 0;
+
+    static int bucket_of(uint32_t us);
+    static uint32_t bucket_limit(int bucket); // largest value in the bucket
+};
+
+// platform clock, mbed_profiler.cpp or host_profiler.cpp
+void profile_clock_init();
+uint32_t profile_ticks();
+uint32_t profile_ticks_to_us(uint32_t ticks);
+
+void profile_record(ProfileStage stage, uint32_t us);
+void profile_start(ProfileStage stage);
+void profile_stop(ProfileStage stage); // ignored without a matching start
+const LatencyHistogram &profile_histogram(ProfileStage stage);
+
+// logs count, p50, p99 and max of every stage that has samples as telemetry
+void profile_report();
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(ProfileStage stage) : stage(stage), start(profile_ticks())
+    {
+    }
+
+    ~ProfileScope()
+    {
+        profile_record(stage, profile_ticks_to_us(profile_ticks() - start));
+    }
+
+private:
+    ProfileStage stage;
+    uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_INIT() profile_clock_init()
+#define PROFILE_SCOPE(stage) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(stage)
+#define PROFILE_START(stage) profile_start(stage)
+#define PROFILE_STOP(stage) profile_stop(stage)
+#define PROFILE_REPORT() profile_report()
+
+#else
+
+#define PROFILE_INIT() ((void)0)
+#define PROFILE_SCOPE(stage) ((void)0)
+#define PROFILE_START(stage) ((void)0)
+#define PROFILE_STOP(stage) ((void)0)
+#define PROFILE_REPORT() ((void)0)
+
+#endif // PROFILING_ENABLED
+
+#endif // PROFILER_HPP
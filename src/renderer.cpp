@@ -0,0 +1,228 @@
+#include "renderer.hpp"
+
+#include <cstring>
+
+#include "text_format.hpp"
+
+Renderer::Renderer(Display &display) : lcd(display)
+{
+}
+
+void Renderer::set_background(uint32_t color)
+{
+    if (color != background)
+    {
+        background = color;
+        full_redraw = true;
+    }
+}
+
+int Renderer::add(Kind kind, Rect area, uint32_t color)
+{
+    if (count == MAX_WIDGETS)
+    {
+        return -1;
+    }
+    Widget &widget = widgets[count];
+    widget.kind = kind;
+    widget.area = area;
+    widget.font = FONT_20;
+    widget.align = ALIGN_LEFT;
+    widget.color = color;
+    widget.dirty = true;
+    widget.shown_valid = false;
+    widget.text[0] = '\0';
+    return count++;
+}
+
+int Renderer::add_label(Rect area, FontSize font, TextAlign align, uint32_t color, const char *text)
+{
+    int id = add(LABEL, area, color);
+    if (id >= 0)
+    {
+        widgets[id].font = font;
+        widgets[id].align = align;
+        set_text(id, text);
+    }
+    return id;
+}
+
+int Renderer::add_frame(Rect area, uint32_t color)
+{
+    return add(FRAME, area, color);
+}
+
+int Renderer::add_fill(Rect area, uint32_t color)
+{
+    return add(FILL, area, color);
+}
+
+void Renderer::set_text(int id, const char *text)
+{
+    if (id < 0 || id >= count)
+    {
+        return;
+    }
+    Widget &widget = widgets[id];
+    if (strncmp(widget.text, text, TEXT_LENGTH - 1) != 0)
+    {
+        strncpy(widget.text, text, TEXT_LENGTH - 1);
+        widget.text[TEXT_LENGTH - 1] = '\0';
+        widget.dirty = true;
+    }
+}
+
+void Renderer::set_number(int id, int32_t value, int decimals)
+{
+    char text[16]; // the longest int32 with a sign and a point
+    format_fixed(text, value, decimals);
+    set_text(id, text);
+}
+
+void Renderer::set_color(int id, uint32_t color)
+{
+    if (id < 0 || id >= count)
+    {
+        return;
+    }
+    if (widgets[id].color != color)
+    {
+        widgets[id].color = color;
+        widgets[id].dirty = true;
+        widgets[id].shown_valid = false; // every cell changes colour
+    }
+}
+
+void Renderer::invalidate()
+{
+    full_redraw = true;
+}
+
+int Renderer::render()
+{
+    int painted = 0;
+
+    if (full_redraw)
+    {
+        lcd.Clear(background);
+        for (int i = 0; i < count; ++i)
+        {
+            widgets[i].shown_valid = false;
+            paint(widgets[i]);
+            widgets[i].dirty = false;
+        }
+        full_redraw = false;
+        lcd.Present(nullptr, 0);
+        return count;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (widgets[i].dirty)
+        {
+            Rect area = paint(widgets[i]);
+            widgets[i].dirty = false;
+            if (area.width > 0)
+            {
+                changed[painted++] = area;
+            }
+        }
+    }
+    if (painted > 0)
+    {
+        lcd.Present(changed, painted);
+    }
+    return painted;
+}
+
+Rect Renderer::paint(Widget &widget)
+{
+    const Rect &area = widget.area;
+
+    switch (widget.kind)
+    {
+    case FILL:
+        lcd.SetTextColor(widget.color);
+        lcd.FillRect(area.x, area.y, area.width, area.height);
+        break;
+
+    case FRAME:
+        lcd.SetTextColor(widget.color);
+        lcd.DrawRect(area.x, area.y, area.width, area.height);
+        break;
+
+    case LABEL:
+        return paint_label(widget);
+    }
+    return area;
+}
+
+Rect Renderer::paint_label(Widget &widget)
+{
+    const Rect &area = widget.area;
+
+    lcd.SetFont(widget.font);
+    uint16_t char_width = lcd.CharWidth();
+    uint16_t height = lcd.Line(1);
+    size_t cells = area.width / char_width;
+    if (cells > TEXT_LENGTH - 1)
+    {
+        cells = TEXT_LENGTH - 1;
+    }
+    size_t length = strlen(widget.text);
+    if (length > cells)
+    {
+        length = cells;
+    }
+
+    // the text placed in the cells, and the cells in the label's box
+    size_t first = 0;
+    uint16_t x = area.x;
+    uint16_t spare = area.width - (uint16_t)cells * char_width;
+    if (widget.align == ALIGN_RIGHT)
+    {
+        first = cells - length;
+        x += spare;
+    }
+    else if (widget.align == ALIGN_CENTER)
+    {
+        first = (cells - length) / 2;
+        x += spare / 2;
+    }
+
+    char line[TEXT_LENGTH];
+    memset(line, ' ', cells);
+    memcpy(line + first, widget.text, length);
+    line[cells] = '\0';
+
+    // one run per stretch of cells that changed, blanks included
+    lcd.SetBackColor(background);
+    lcd.SetTextColor(widget.color);
+    size_t lowest = cells, highest = 0;
+    size_t i = 0;
+    while (i < cells)
+    {
+        if (widget.shown_valid && line[i] == widget.shown[i])
+        {
+            ++i;
+            continue;
+        }
+        size_t run = i;
+        while (i < cells && !(widget.shown_valid && line[i] == widget.shown[i]))
+        {
+            ++i;
+        }
+        lcd.DrawText(x + (uint16_t)run * char_width, area.y, &line[run], i - run);
+        lowest = run < lowest ? run : lowest;
+        highest = i;
+    }
+
+    memcpy(widget.shown, line, cells + 1);
+    widget.shown_valid = true;
+
+    if (lowest >= highest)
+    {
+        return {x, area.y, 0, 0};
+    }
+    return {(uint16_t)(x + lowest * char_width), area.y, (uint16_t)((highest - lowest) * char_width), height};
+}
@@ -0,0 +1,76 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <cstdint>
+
+#include "hal.hpp"
+
+// Retained-mode screen. The app sets widget contents whenever it likes;
+// render() repaints only the widgets whose text or colour actually changed
+// into the display's back buffer and presents just those areas. Nothing is
+// cleared and redrawn wholesale, so values update without flicker.
+//
+// A label is a row of fixed-width character cells. Each one remembers what
+// its cells show, and a new text only redraws the runs of cells that differ,
+// so a readout going from 12.34 to 12.35 repaints a single digit.
+class Renderer
+{
+public:
+    static const int MAX_WIDGETS = 32;
+    static const int TEXT_LENGTH = 24;
+
+    explicit Renderer(Display &display);
+
+    void set_background(uint32_t color);
+
+    // widgets are painted in the order they were added; ids are stable
+    int add_label(Rect area, FontSize font, TextAlign align, uint32_t color, const char *text = "");
+    int add_frame(Rect area, uint32_t color); // one pixel outline
+    int add_fill(Rect area, uint32_t color);  // solid block
+
+    void set_text(int id, const char *text);
+    void set_number(int id, int32_t value, int decimals = 0); // fixed point, see format_fixed()
+    void set_color(int id, uint32_t color);
+
+    // repaint everything on the next render(), e.g. after a full screen
+    // animation drew over the widgets
+    void invalidate();
+
+    // paints and presents whatever changed; returns the number of widgets
+    // repainted
+    int render();
+
+private:
+    enum Kind
+    {
+        LABEL,
+        FRAME,
+        FILL
+    };
+
+    struct Widget
+    {
+        Kind kind;
+        Rect area;
+        FontSize font;
+        TextAlign align;
+        uint32_t color;
+        bool dirty;
+        bool shown_valid; // `shown` matches the screen
+        char text[TEXT_LENGTH];
+        char shown[TEXT_LENGTH]; // a label's cells as last painted
+    };
+
+    Display &lcd;
+    Widget widgets[MAX_WIDGETS];
+    Rect changed[MAX_WIDGETS];
+    int count = 0;
+    uint32_t background = COLOR_BLUE;
+    bool full_redraw = true;
+
+    int add(Kind kind, Rect area, uint32_t color);
+    Rect paint(Widget &widget); // returns the area actually repainted
+    Rect paint_label(Widget &widget);
+};
+
+#endif // RENDERER_HPP
@@ -0,0 +1,142 @@
+#include "sampler.hpp"
+
+#include "telemetry.hpp"
+
+Sampler::Sampler(Gyro &gyro) : gyro(gyro)
+{
+}
+
+Sampler::Ring &Sampler::samples()
+{
+    return ring;
+}
+
+Sampler::Published Sampler::read_published() const
+{
+    // a sequence lock: the producer never waits, a reader that overlapped a
+    // publication simply copies again
+    Published copy;
+    uint32_t before, after;
+    do
+    {
+        before = published_sequence.load(std::memory_order_acquire);
+        copy = published;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = published_sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return copy;
+}
+
+Sampler::Stats Sampler::stats() const
+{
+    Published copy = read_published();
+    Stats snapshot = copy.counters;
+    snapshot.ring_drops = ring.dropped();
+    if (copy.intervals > 0)
+    {
+        snapshot.mean_interval_us = (uint32_t)(copy.interval_sum_us / copy.intervals);
+    }
+    return snapshot;
+}
+
+uint32_t Sampler::jitter_us() const
+{
+    Published copy = read_published();
+    if (copy.intervals == 0)
+    {
+        return 0;
+    }
+    const Stats &counters = copy.counters;
+    uint32_t early = nominal_interval_us > counters.min_interval_us ? nominal_interval_us - counters.min_interval_us : 0;
+    uint32_t late = counters.max_interval_us > nominal_interval_us ? counters.max_interval_us - nominal_interval_us : 0;
+    return early > late ? early : late;
+}
+
+void Sampler::collect(uint32_t timestamp_us)
+{
+    GyroData batch[Gyro::FIFO_DEPTH];
+
+    size_t count = gyro.fifo_result(batch, Gyro::FIFO_DEPTH);
+    if (count > 0)
+    {
+        on_batch(timestamp_us, batch, count, gyro.fifo_overrun);
+    }
+}
+
+void Sampler::on_batch(uint32_t timestamp_us, const GyroData *batch, size_t count, bool overrun)
+{
+    if (telemetry_streaming())
+    {
+        telemetry_stream(timestamp_us / 1000, batch, count);
+    }
+
+    uint32_t pushed = 0, bias_updates = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (ring.push(batch[i]))
+        {
+            pushed++;
+        }
+        if (track_drift(batch[i]))
+        {
+            bias_updates++;
+        }
+    }
+
+    // the counters change only while the sequence is odd
+    uint32_t sequence = published_sequence.load(std::memory_order_relaxed);
+    published_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Stats &counters = published.counters;
+    if (counters.batches > 0 && !resumed)
+    {
+        // unsigned subtraction keeps this right across the 32-bit wrap
+        uint32_t interval = timestamp_us - last_timestamp_us;
+        if (published.intervals == 0 || interval < counters.min_interval_us)
+        {
+            counters.min_interval_us = interval;
+        }
+        if (interval > counters.max_interval_us)
+        {
+            counters.max_interval_us = interval;
+        }
+        published.interval_sum_us += interval;
+        published.intervals++;
+    }
+    last_timestamp_us = timestamp_us;
+    resumed = false;
+    counters.batches++;
+
+    if (overrun)
+    {
+        counters.fifo_overruns++;
+    }
+    counters.samples += pushed;
+    counters.bias_updates += bias_updates;
+
+    published_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool Sampler::track_drift(const GyroData &sample)
+{
+    if (!gyro.is_calibrated())
+    {
+        return false;
+    }
+
+    drift.add(sample.x_raw, sample.y_raw, sample.z_raw);
+    if (!drift.stationary())
+    {
+        drift.reset(); // moving: nothing to learn about the bias
+        return false;
+    }
+    if (drift.count() >= DRIFT_WINDOW && drift.converged())
+    {
+        // runs on the thread that decodes, so the bias never changes mid-sample
+        gyro.set_bias(gyro.x_bias + drift.mean(0), gyro.y_bias + drift.mean(1), gyro.z_bias + drift.mean(2));
+        drift.reset();
+        return true;
+    }
+    return false;
+}
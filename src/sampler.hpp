@@ -0,0 +1,97 @@
+#ifndef SAMPLER_HPP
+#define SAMPLER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "bias_estimator.hpp"
+#include "gyroscope.hpp"
+#include "spsc_ring.hpp"
+
+// Real-time acquisition: a high priority thread drains the gyro FIFO every
+// time the watermark interrupt fires and pushes each sample into a lock-free
+// ring. Everything else (UI, recording, matching) consumes from that ring at
+// its own pace.
+class Sampler
+{
+public:
+    static const uint32_t ODR_HZ = Gyro::ODR_HZ;
+    static const size_t RING_SIZE = 256; // 1.28 s of headroom at 200 Hz
+    static const uint32_t DRIFT_WINDOW = 2 * ODR_HZ; // still samples before the bias is re-estimated
+
+    typedef SpscRing<GyroData, RING_SIZE> Ring;
+
+    struct Stats
+    {
+        uint32_t samples;        // samples pushed into the ring
+        uint32_t batches;        // FIFO drains
+        uint32_t ring_drops;     // samples lost because the consumer fell behind
+        uint32_t fifo_overruns;  // drains that found the sensor FIFO had wrapped
+        uint32_t min_interval_us; // shortest / longest gap between drains
+        uint32_t max_interval_us;
+        uint32_t mean_interval_us;
+        uint32_t bias_updates;   // drift corrections applied while the board was still
+    };
+
+    explicit Sampler(Gyro &gyro);
+
+    // enables the FIFO and starts the acquisition thread
+    bool start(uint8_t watermark);
+
+    // Stops draining and disables the FIFO. Once it returns the caller owns
+    // the gyro, as it did before start(), until resume() hands it back.
+    void suspend();
+    bool resume();
+
+    Ring &samples();
+
+    // Both are safe from any thread: they copy the counters out and retry if
+    // the acquisition thread published a batch meanwhile.
+    Stats stats() const;
+
+    // worst deviation of a drain interval from the nominal one
+    uint32_t jitter_us() const;
+
+    // producer side: empties the gyro FIFO into the ring, called once per
+    // watermark interrupt by the acquisition thread (or the host simulation).
+    // The SPI transfers run asynchronously and leave the CPU to other threads.
+    void drain(uint32_t timestamp_us);
+
+    // producer side, the samples of a completed asynchronous FIFO drain
+    void collect(uint32_t timestamp_us);
+
+    // producer side, bookkeeping for one drained batch
+    void on_batch(uint32_t timestamp_us, const GyroData *batch, size_t count, bool overrun);
+
+private:
+    Gyro &gyro;
+    Ring ring;
+
+    uint8_t watermark = 0;
+    uint32_t nominal_interval_us = 0;
+
+    // residual bias of the corrected samples, followed whenever the board
+    // rests so temperature drift never accumulates
+    BiasEstimator drift;
+
+    uint32_t last_timestamp_us = 0;
+    bool resumed = false; // the gap before the next drain is a pause, not jitter
+
+    // written by the producer only, once per batch
+    struct Published
+    {
+        Stats counters;
+        uint64_t interval_sum_us;
+        uint32_t intervals; // drain intervals in interval_sum_us
+    };
+    Published published = {};
+    std::atomic<uint32_t> published_sequence{0}; // odd while a batch is being published
+
+    Published read_published() const;
+
+    void run();
+    bool track_drift(const GyroData &sample); // true when it corrected the bias
+};
+
+#endif // SAMPLER_HPP
@@ -0,0 +1,155 @@
+#include "segmenter.hpp"
+
+#include <cstdlib>
+
+void Segmenter::reset()
+{
+    count = 0;
+    last_motion = 0;
+    quiet_limit = QUIET_SAMPLES;
+    active = false;
+    done = false;
+    idle = 0;
+    window_sum = 0;
+    window_fill = 0;
+    window_pos = 0;
+}
+
+bool Segmenter::capturing() const
+{
+    return active;
+}
+
+int Segmenter::length() const
+{
+    return active || done ? count : 0;
+}
+
+int Segmenter::motion_length() const
+{
+    return active || done ? last_motion : 0;
+}
+
+void Segmenter::end_early()
+{
+    if (active)
+    {
+        quiet_limit = EARLY_QUIET_SAMPLES;
+    }
+}
+
+void Segmenter::append(const int16_t xyz[3])
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        sums[k][count + 1] = sums[k][count] + xyz[k];
+    }
+    count++;
+}
+
+void Segmenter::start()
+{
+    // the window that crossed START_LEVEL holds the onset of the motion
+    count = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        sums[k][0] = 0;
+    }
+    for (int i = 0; i < window_fill; ++i)
+    {
+        int slot = (window_pos - window_fill + i + WINDOW) % WINDOW;
+        const int16_t xyz[3] = {recent[0][slot], recent[1][slot], recent[2][slot]};
+        append(xyz);
+    }
+    last_motion = count;
+    quiet_limit = QUIET_SAMPLES;
+    active = true;
+}
+
+Segmenter::Event Segmenter::add(const GyroData &sample)
+{
+    if (done)
+    {
+        return NONE;
+    }
+
+    const int16_t xyz[3] = {sample.x_raw, sample.y_raw, sample.z_raw};
+    int32_t energy = abs(xyz[0]) + abs(xyz[1]) + abs(xyz[2]);
+
+    if (window_fill == WINDOW)
+    {
+        window_sum -= energies[window_pos];
+    }
+    else
+    {
+        window_fill++;
+    }
+    energies[window_pos] = energy;
+    for (int k = 0; k < 3; ++k)
+    {
+        recent[k][window_pos] = xyz[k];
+    }
+    window_sum += energy;
+    window_pos = (window_pos + 1) % WINDOW;
+
+    int32_t level = window_sum / window_fill;
+
+    if (!active)
+    {
+        if (window_fill == WINDOW && level > START_LEVEL)
+        {
+            start();
+            return STARTED;
+        }
+        if (++idle >= ARM_TIMEOUT)
+        {
+            done = true;
+            return TIMED_OUT;
+        }
+        return NONE;
+    }
+
+    append(xyz);
+    if (level > STOP_LEVEL)
+    {
+        last_motion = count;
+        quiet_limit = QUIET_SAMPLES; // a resumed gesture gets the full pause again
+    }
+
+    if (count - last_motion < quiet_limit && count < MAX_SAMPLES)
+    {
+        return count - last_motion == 1 && last_motion >= MIN_SAMPLES ? PAUSED : NONE;
+    }
+
+    // trailing stillness is not part of the gesture
+    count = last_motion;
+    active = false;
+    if (count < MIN_SAMPLES)
+    {
+        // a bump: keep waiting for the real gesture
+        count = 0;
+        return NONE;
+    }
+    done = true;
+    return FINISHED;
+}
+
+void Segmenter::resample(Gesture &out) const
+{
+    int n = last_motion;
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        // every captured sample lands in exactly one output bin
+        int begin = i * n / SAMPLES;
+        int end = (i + 1) * n / SAMPLES;
+        if (end == begin)
+        {
+            end = begin + 1;
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            int32_t sum = sums[k][end] - sums[k][begin];
+            out.axis[k][i] = normalize((int16_t)(sum / (end - begin)));
+        }
+    }
+}
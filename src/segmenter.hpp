@@ -0,0 +1,82 @@
+#ifndef SEGMENTER_HPP
+#define SEGMENTER_HPP
+
+#include <cstdint>
+
+#include "filter_bank.hpp"
+#include "gyroscope.hpp"
+#include "matcher.hpp"
+
+// Online gesture segmentation on the conditioned sample stream. The mean
+// absolute rate over a short window must rise above START_LEVEL to begin a
+// gesture and stay below the lower STOP_LEVEL for QUIET_SAMPLES to end it,
+// so noise around one threshold cannot chatter. The gesture is kept as
+// running per-axis sums at RATE_HZ, whatever its length up to MAX_SAMPLES,
+// so resample() reduces it to the matcher's SAMPLES in constant time. Dead
+// time before and after the motion is never part of the gesture.
+//
+// The first quiet sample after motion is reported as PAUSED: if the
+// stillness lasts, the gesture ends right there, so resample() already
+// yields the final gesture and the caller can score it while the quiet
+// runs out. A decisive score can call end_early() to stop waiting after
+// EARLY_QUIET_SAMPLES instead.
+class Segmenter
+{
+public:
+    static const uint32_t RATE_HZ = FilterBank::OUTPUT_HZ;        // samples arrive filtered and decimated
+    static const int WINDOW = RATE_HZ / 25;                       // 40 ms energy window
+    static const int32_t START_LEVEL = GyroConfig::counts(13125); // mean |x|+|y|+|z| in counts, ~13 dps
+    static const int32_t STOP_LEVEL = GyroConfig::counts(5250);   // ~5 dps
+    static const int QUIET_SAMPLES = RATE_HZ * 3 / 10;            // 300 ms below STOP_LEVEL ends a gesture
+    static const int EARLY_QUIET_SAMPLES = RATE_HZ / 10;          // 100 ms after end_early()
+    static const int MIN_SAMPLES = RATE_HZ * 3 / 10;              // shorter bursts are bumps, not gestures
+    static const int MAX_SAMPLES = RATE_HZ * 512 / 100;           // 5.1 s, longer gestures are cut here
+    static const int ARM_TIMEOUT = RATE_HZ * 10;                  // 10 s without motion gives up
+
+    enum Event
+    {
+        NONE,
+        STARTED,   // motion detected, capturing
+        PAUSED,    // motion stopped; resample() holds the gesture as it would end here
+        FINISHED,  // a complete gesture is ready for resample()
+        TIMED_OUT  // no gesture since reset()
+    };
+
+    // arms the segmenter for a new gesture
+    void reset();
+
+    Event add(const GyroData &sample);
+
+    bool capturing() const;
+    int length() const; // samples captured so far
+    int motion_length() const; // samples up to the last motion, what resample() covers
+
+    // the current pause ends the gesture after EARLY_QUIET_SAMPLES, unless
+    // motion resumes first
+    void end_early();
+
+    // box-filters the gesture up to the last motion down to SAMPLES points
+    void resample(Gesture &out) const;
+
+private:
+    int32_t sums[3][MAX_SAMPLES + 1]; // sums[k][n]: axis k over the first n samples
+    int count = 0;
+    int last_motion = 0; // length when the level was last above STOP_LEVEL
+    int quiet_limit = QUIET_SAMPLES; // stillness that ends the gesture
+    bool active = false;
+    bool done = false;
+    int idle = 0;        // samples seen while armed and waiting
+
+    // sliding window of per-sample energies; the newest WINDOW samples are
+    // also the pre-roll copied in when a gesture starts
+    int32_t energies[WINDOW];
+    int16_t recent[3][WINDOW];
+    int32_t window_sum = 0;
+    int window_fill = 0;
+    int window_pos = 0;
+
+    void start();
+    void append(const int16_t xyz[3]);
+};
+
+#endif // SEGMENTER_HPP
@@ -0,0 +1,56 @@
+#ifndef SPI_BUS_HPP
+#define SPI_BUS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+typedef void (*SpiCallback)(void *context);
+
+// One full-duplex exchange. Whoever submits it owns the transaction and its
+// buffers, and must not touch either until `done` has run.
+struct SpiTransaction
+{
+    const uint8_t *tx;
+    uint8_t *rx;
+    size_t len;
+    SpiCallback done; // may be null
+    void *context;
+    SpiTransaction *next; // queue link, owned by the bus
+    bool failed; // set by the bus before `done` runs; rx then holds garbage
+};
+
+// A transaction that carries its own buffers, for up to N bytes
+template <size_t N>
+struct SpiFrame : SpiTransaction
+{
+    uint8_t tx_buf[N];
+    uint8_t rx_buf[N];
+
+    SpiFrame() : SpiTransaction{tx_buf, rx_buf, N, nullptr, nullptr, nullptr, false}
+    {
+    }
+};
+
+// Minimal full-duplex SPI seam so sensor drivers can run against the real
+// SPI5 peripheral on the board or against a mock on the host.
+//
+// Transactions run one at a time in submission order. Any thread may submit,
+// so several drivers and threads can share one bus as long as each brings
+// its own transaction.
+class SpiBus
+{
+public:
+    virtual ~SpiBus() = default;
+
+    // Queues `t` and returns at once. On the target `done` runs from the
+    // completion interrupt, after the next queued transaction has already
+    // been started; it must be short, but it may submit more. `done` runs
+    // whether or not the transfer went through, so check `failed` first.
+    virtual void submit(SpiTransaction &t) = 0;
+
+    // exchanges len bytes; blocks the calling thread until the transfer has
+    // completed, letting others run meanwhile
+    virtual void transfer(const uint8_t *tx, uint8_t *rx, size_t len) = 0;
+};
+
+#endif // SPI_BUS_HPP
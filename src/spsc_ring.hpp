@@ -0,0 +1,88 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer ring. One thread (or ISR) may
+// push and one other thread may pop; neither side ever blocks. When the ring
+// is full new items are dropped and counted rather than overwriting data
+// the consumer may be reading.
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+private:
+    T buf[N];
+    std::atomic<size_t> head{0}; // next slot to write, owned by the producer
+    std::atomic<size_t> tail{0}; // next slot to read, owned by the consumer
+    std::atomic<uint32_t> drops{0};
+
+public:
+    static const size_t CAPACITY = N;
+
+    // producer side
+    bool push(const T &item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N)
+        {
+            drops.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buf[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // producer side: all of `items` or none of them, published together so
+    // the consumer never sees a partial group
+    bool push_all(const T *items, size_t count)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (N - (h - tail.load(std::memory_order_acquire)) < count)
+        {
+            drops.fetch_add((uint32_t)count, std::memory_order_relaxed);
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            buf[(h + i) & (N - 1)] = items[i];
+        }
+        head.store(h + count, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    bool pop(T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = buf[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side: discard everything queued so far
+    void flush()
+    {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    size_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t dropped() const
+    {
+        return drops.load(std::memory_order_relaxed);
+    }
+};
+
+#endif // SPSC_RING_HPP
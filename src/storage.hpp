@@ -0,0 +1,21 @@
+#ifndef STORAGE_HPP
+#define STORAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte-addressed non-volatile storage. Writes must not cross a page boundary;
+// callers are expected to split them on page_size().
+class Storage
+{
+public:
+    virtual ~Storage() = default;
+
+    virtual uint32_t size() const = 0;
+    virtual uint32_t page_size() const = 0;
+
+    virtual bool read(uint32_t addr, uint8_t *buf, size_t len) = 0;
+    virtual bool write(uint32_t addr, const uint8_t *buf, size_t len) = 0;
+};
+
+#endif // STORAGE_HPP
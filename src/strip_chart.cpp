@@ -0,0 +1,57 @@
+#include "strip_chart.hpp"
+
+// x, y and z, bright enough to read against the black background
+static const uint32_t TRACE_COLORS[StripChart::TRACES] = {0xFFFF4040, 0xFF40FF40, 0xFF40C0FF};
+static const uint32_t AXIS_COLOR = 0xFF404040;
+static const uint32_t CHART_BACKGROUND = COLOR_BLACK;
+
+StripChart::StripChart(Display &display) : lcd(display)
+{
+}
+
+void StripChart::begin(Rect chart, int32_t scale)
+{
+    area = chart;
+    full_scale = scale > 0 ? scale : 1;
+    started = false;
+    lcd.PlotBegin(area, CHART_BACKGROUND);
+}
+
+void StripChart::show(bool visible)
+{
+    if (visible != shown)
+    {
+        shown = visible;
+        lcd.PlotShow(visible);
+    }
+}
+
+uint16_t StripChart::row(int32_t value) const
+{
+    // positive rates up, clamped to the chart
+    int32_t bottom = area.height - 1;
+    int32_t y = bottom / 2 - value * (bottom / 2) / full_scale;
+    return (uint16_t)(y < 0 ? 0 : y > bottom ? bottom : y);
+}
+
+void StripChart::add(const GyroData &sample)
+{
+    if (area.height == 0)
+    {
+        return;
+    }
+
+    const int16_t values[TRACES] = {sample.x_raw, sample.y_raw, sample.z_raw};
+    PlotSpan spans[1 + TRACES];
+    uint16_t zero = row(0);
+    spans[0] = {zero, zero, AXIS_COLOR};
+    for (int i = 0; i < TRACES; ++i)
+    {
+        uint16_t now = row(values[i]);
+        uint16_t before = started ? last[i] : now;
+        spans[1 + i] = {before < now ? before : now, before < now ? now : before, TRACE_COLORS[i]};
+        last[i] = now;
+    }
+    started = true;
+    lcd.PlotColumn(spans, 1 + TRACES);
+}
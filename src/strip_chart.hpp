@@ -0,0 +1,38 @@
+#ifndef STRIP_CHART_HPP
+#define STRIP_CHART_HPP
+
+#include <cstdint>
+
+#include "gyroscope.hpp"
+#include "hal.hpp"
+
+// Live plot of the three gyro axes on the display's strip chart layer, one
+// column per sample. Each axis is drawn as a vertical stroke from where its
+// trace was to where it is now, so fast motion stays a connected line, over
+// a dim zero line. A column costs the same whatever the chart shows, and
+// nothing on the frame buffers is touched.
+class StripChart
+{
+public:
+    static const int TRACES = 3;
+
+    explicit StripChart(Display &display);
+
+    // an empty chart over `area`, +-full_scale raw counts from top to bottom
+    void begin(Rect area, int32_t full_scale);
+    void show(bool visible);
+
+    void add(const GyroData &sample);
+
+private:
+    Display &lcd;
+    Rect area = {};
+    int32_t full_scale = 1;
+    uint16_t last[TRACES] = {}; // each trace's row in the previous column
+    bool started = false;       // `last` holds a column
+    bool shown = false;
+
+    uint16_t row(int32_t value) const;
+};
+
+#endif // STRIP_CHART_HPP
@@ -0,0 +1,216 @@
+#include "telemetry.hpp"
+
+#include <atomic>
+
+#include "hal.hpp"
+#include "spsc_ring.hpp"
+
+static_assert(TM_ID_COUNT <= 256, "telemetry ids must fit a byte");
+
+static const size_t HEADER_SIZE = 3; // sync, id, length
+
+typedef SpscRing<uint8_t, 1024> EventRing;  // UI thread -> drain
+typedef SpscRing<uint8_t, 2048> SampleRing; // sampler thread -> drain, ~1 s of streaming
+
+static EventRing event_ring;
+static SampleRing sample_ring;
+static std::atomic<uint32_t> dropped_frames{0};
+static std::atomic<bool> streaming{TELEMETRY_STREAM_SAMPLES != 0};
+static std::atomic<bool> low_power{false};
+static uint32_t sample_sequence = 0; // sampler thread only
+static std::atomic<int> pending_command{-1};
+
+// CRC-8, polynomial 0x07
+uint8_t telemetry_crc8(const uint8_t *data, size_t len, uint8_t crc)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (uint8_t)(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+// builds one frame in place; every put_* silently stops at the payload limit,
+// which only the fixed-size callers below could ever reach
+class FrameWriter
+{
+public:
+    explicit FrameWriter(TelemetryId id) : length(HEADER_SIZE)
+    {
+        bytes[0] = TELEMETRY_SYNC;
+        bytes[1] = id;
+    }
+
+    void put_varint(uint32_t value)
+    {
+        while (value >= 0x80 && length < HEADER_SIZE + TELEMETRY_MAX_PAYLOAD)
+        {
+            bytes[length++] = (uint8_t)(value | 0x80);
+            value >>= 7;
+        }
+        if (length < HEADER_SIZE + TELEMETRY_MAX_PAYLOAD)
+        {
+            bytes[length++] = (uint8_t)value;
+        }
+    }
+
+    void put_signed(int32_t value)
+    {
+        // zigzag: small magnitudes of either sign stay short
+        put_varint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+    }
+
+    // finishes the frame and returns its size
+    size_t finish()
+    {
+        bytes[2] = (uint8_t)(length - HEADER_SIZE);
+        bytes[length] = telemetry_crc8(&bytes[1], length - 1);
+        return length + 1;
+    }
+
+    uint8_t bytes[TELEMETRY_MAX_FRAME];
+
+private:
+    size_t length;
+};
+
+static void log_event(TelemetryId id, const int32_t *args, size_t count)
+{
+    FrameWriter frame(id);
+    frame.put_varint(hal_now_ms());
+    for (size_t i = 0; i < count; ++i)
+    {
+        frame.put_signed(args[i]);
+    }
+    if (!event_ring.push_all(frame.bytes, frame.finish()))
+    {
+        dropped_frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void telemetry_log(TelemetryId id)
+{
+    log_event(id, nullptr, 0);
+}
+
+void telemetry_log(TelemetryId id, int32_t a)
+{
+    const int32_t args[] = {a};
+    log_event(id, args, 1);
+}
+
+void telemetry_log(TelemetryId id, int32_t a, int32_t b)
+{
+    const int32_t args[] = {a, b};
+    log_event(id, args, 2);
+}
+
+void telemetry_log(TelemetryId id, int32_t a, int32_t b, int32_t c)
+{
+    const int32_t args[] = {a, b, c};
+    log_event(id, args, 3);
+}
+
+void telemetry_log(TelemetryId id, int32_t a, int32_t b, int32_t c, int32_t d)
+{
+    const int32_t args[] = {a, b, c, d};
+    log_event(id, args, 4);
+}
+
+void telemetry_set_streaming(bool enabled)
+{
+    streaming.store(enabled, std::memory_order_relaxed);
+}
+
+bool telemetry_streaming()
+{
+    return streaming.load(std::memory_order_relaxed);
+}
+
+void telemetry_set_low_power(bool enabled)
+{
+    low_power.store(enabled, std::memory_order_relaxed);
+}
+
+bool telemetry_low_power()
+{
+    return low_power.load(std::memory_order_relaxed);
+}
+
+void telemetry_stream(uint32_t timestamp_ms, const GyroData *samples, size_t count)
+{
+    while (count > 0)
+    {
+        size_t chunk = count < TELEMETRY_SAMPLES_PER_FRAME ? count : TELEMETRY_SAMPLES_PER_FRAME;
+
+        FrameWriter frame(TM_SAMPLES);
+        frame.put_varint(timestamp_ms);
+        frame.put_varint(sample_sequence);
+        frame.put_varint((uint32_t)chunk);
+        int16_t previous[3] = {0, 0, 0};
+        for (size_t i = 0; i < chunk; ++i)
+        {
+            const int16_t current[3] = {samples[i].x_raw, samples[i].y_raw, samples[i].z_raw};
+            for (int k = 0; k < 3; ++k)
+            {
+                frame.put_signed((int32_t)current[k] - previous[k]);
+                previous[k] = current[k];
+            }
+        }
+
+        // a dropped frame still advances the sequence, so the host sees the gap
+        sample_sequence += (uint32_t)chunk;
+        if (!sample_ring.push_all(frame.bytes, frame.finish()))
+        {
+            dropped_frames.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        samples += chunk;
+        count -= chunk;
+    }
+}
+
+// moves whole frames only, so frames from the two rings never interleave
+template <typename Ring>
+static size_t drain_ring(Ring &ring, uint8_t *out, size_t capacity)
+{
+    size_t used = 0;
+    while (capacity - used >= TELEMETRY_MAX_FRAME && ring.pop(out[used]))
+    {
+        // frames are published whole, so the rest of this one is already there
+        ring.pop(out[used + 1]);
+        ring.pop(out[used + 2]);
+        size_t rest = out[used + 2] + 1u;
+        used += HEADER_SIZE;
+        for (size_t i = 0; i < rest; ++i)
+        {
+            ring.pop(out[used++]);
+        }
+    }
+    return used;
+}
+
+size_t telemetry_drain(uint8_t *out, size_t capacity)
+{
+    size_t used = drain_ring(event_ring, out, capacity);
+    return used + drain_ring(sample_ring, out + used, capacity - used);
+}
+
+uint32_t telemetry_dropped()
+{
+    return dropped_frames.load(std::memory_order_relaxed);
+}
+
+void telemetry_post_command(uint8_t command)
+{
+    pending_command.store(command, std::memory_order_relaxed);
+}
+
+int telemetry_take_command()
+{
+    return pending_command.exchange(-1, std::memory_order_relaxed);
+}
@@ -0,0 +1,113 @@
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gyroscope.hpp"
+
+// Deferred binary telemetry. Logging a message only encodes its id and integer
+// arguments into a ring buffer; a low priority drain ships the bytes and all
+// formatting happens on the host (tools/telemetry_decode). Nothing on the
+// sampling or matching path waits for the UART, and no format strings are
+// linked into the firmware.
+//
+// Frame: TELEMETRY_SYNC, id, payload length, payload, CRC-8 over id..payload.
+// Event payloads are the timestamp in ms followed by the arguments, all as
+// zigzag varints. TM_SAMPLES payloads carry the timestamp, the sequence number
+// of the first sample, the count, the first sample and then per-axis deltas
+// to the previous sample, so a still board costs about a byte per axis.
+//
+// Events may only be logged from the UI thread and samples only from the
+// sampler thread: each has its own single-producer ring.
+
+#ifndef TELEMETRY_STREAM_SAMPLES
+#define TELEMETRY_STREAM_SAMPLES 0 // stream every sensor sample from boot
+#endif
+
+// ids are part of the wire format: append only, never reorder
+enum TelemetryId : uint8_t
+{
+    TM_BOOT,
+    TM_GYRO_INIT_FAILED,
+    TM_SAMPLER_START_FAILED,
+    TM_BIAS_RESTORED,       // x, y, z bias in 1/1000 count
+    TM_CALIBRATED,          // ms taken, x, y, z bias in 1/1000 count
+    TM_CALIBRATION_TIMEOUT,
+    TM_RECORDING,
+    TM_UNLOCKING,
+    TM_PERSIST_FAILED,
+    TM_SIMILARITY,          // Q15
+    TM_UNLOCKED,
+    TM_REJECTED,
+    TM_SAMPLER_STATS,       // samples, ring drops, FIFO overruns
+    TM_SAMPLER_TIMING,      // min, mean, max interval, jitter in us
+    TM_MATCH_ENERGY,        // energy of both gestures, Q15
+    TM_MATCH_SUMS,          // gesture 1 or 2, x, y, z sums
+    TM_MATCH_MSE,           // Q15
+    TM_MATCH_TERMS,         // normalized mse, energy, sign, Q15
+    TM_MATCH_RESULT,        // Q15
+    TM_DTW_COST,            // cost Q22, similarity Q15
+    TM_DTW_ABANDONED,       // limit Q22
+    TM_SAMPLES,             // raw sample stream, see above
+    TM_SEGMENT,             // gesture length in samples
+    TM_SEGMENT_TIMEOUT,
+    TM_PROFILE_STAGE,       // stage, samples, max in us
+    TM_PROFILE_PERCENTILES, // stage, p50, p99 in us
+    TM_ENROLLED,            // user number
+    TM_IDENTIFY,            // templates bounded, fully compared, enrolled
+    TM_IDENTIFIED,          // user number
+    TM_DOZING,              // ms idle before dozing
+    TM_STANDBY,             // ms dozed before the gyro powered down
+    TM_WAKE,                // source, ms from trigger to full-rate samples, ms asleep
+    TM_PAUSE_SCORED,        // gesture length, similarity Q15, 1 if the capture ends early
+    TM_SPOTTED,             // user (1-based), similarity Q15, samples the spotted gesture took
+    TM_SPOT_FULL,           // user (1-based) the spotter had no room for
+    TM_ID_COUNT
+};
+
+static const uint8_t TELEMETRY_SYNC = 0xA5;
+static const size_t TELEMETRY_MAX_PAYLOAD = 255;
+static const size_t TELEMETRY_MAX_FRAME = 3 + TELEMETRY_MAX_PAYLOAD + 1;
+static const size_t TELEMETRY_MAX_ARGS = 4;
+static const size_t TELEMETRY_SAMPLES_PER_FRAME = 16; // worst case deltas still fit the payload
+
+void telemetry_log(TelemetryId id);
+void telemetry_log(TelemetryId id, int32_t a);
+void telemetry_log(TelemetryId id, int32_t a, int32_t b);
+void telemetry_log(TelemetryId id, int32_t a, int32_t b, int32_t c);
+void telemetry_log(TelemetryId id, int32_t a, int32_t b, int32_t c, int32_t d);
+
+// raw sample streaming at the full ODR, off unless enabled
+void telemetry_set_streaming(bool enabled);
+bool telemetry_streaming();
+void telemetry_stream(uint32_t timestamp_ms, const GyroData *samples, size_t count);
+
+// While dozing the drain polls the rings rarely and stops listening for
+// commands, which would otherwise keep the UART clocked and the MCU out of
+// deep sleep. Logging itself is unaffected.
+void telemetry_set_low_power(bool enabled);
+bool telemetry_low_power();
+
+// consumer side: moves whole queued frames, events first, into `out`; room
+// for fewer than TELEMETRY_MAX_FRAME bytes moves nothing
+size_t telemetry_drain(uint8_t *out, size_t capacity);
+
+// frames that did not fit their ring
+uint32_t telemetry_dropped();
+
+// One byte commands from the host, typed into the serial terminal on the
+// target. The drain side posts them and the UI thread takes them; a command
+// not yet taken is replaced by the next one.
+static const uint8_t TELEMETRY_CMD_PROFILE = 'p'; // log the profiling histograms
+
+void telemetry_post_command(uint8_t command);
+int telemetry_take_command(); // pending command, or -1
+
+// starts the platform's drain: a low priority UART thread on the target,
+// nothing on the host where the simulation drains it itself
+void telemetry_start();
+
+uint8_t telemetry_crc8(const uint8_t *data, size_t len, uint8_t crc = 0);
+
+#endif // TELEMETRY_HPP
@@ -0,0 +1,126 @@
+#include "template_index.hpp"
+
+static const uint32_t PRUNED = UINT32_MAX;
+
+template <class Matcher>
+TemplateIndex<Matcher>::TemplateIndex(Entry *storage, int capacity) : entries(storage), capacity(capacity)
+{
+}
+
+template <class Matcher>
+void TemplateIndex<Matcher>::clear()
+{
+    count = 0;
+}
+
+template <class Matcher>
+int TemplateIndex<Matcher>::size() const
+{
+    return count;
+}
+
+template <class Matcher>
+bool TemplateIndex<Matcher>::add(int id, const Gesture &gesture)
+{
+    int slot = 0;
+    while (slot < count && entries[slot].id != id)
+    {
+        slot++;
+    }
+    if (slot == capacity)
+    {
+        return false;
+    }
+
+    Entry &e = entries[slot];
+    e.id = id;
+    e.gesture = gesture;
+    Matcher::features(gesture, e.features);
+
+    if (slot == count)
+    {
+        count++;
+    }
+    return true;
+}
+
+template <class Matcher>
+int TemplateIndex<Matcher>::next_candidate(uint32_t limit) const
+{
+    int best = -1;
+    for (int e = 0; e < count; ++e)
+    {
+        if (entries[e].bound <= limit && (best < 0 || entries[e].bound < entries[best].bound))
+        {
+            best = e;
+        }
+    }
+    return best;
+}
+
+template <class Matcher>
+void TemplateIndex<Matcher>::evaluate(int e, const Gesture &probe, const typename Matcher::Features &features,
+                                      uint32_t &best_cost, Match &match)
+{
+    uint32_t cost = Matcher::cost(probe, features, entries[e].gesture, entries[e].features, best_cost);
+    match.evaluated++;
+    if (cost < best_cost)
+    {
+        best_cost = cost;
+        match.id = entries[e].id;
+    }
+    entries[e].bound = PRUNED;
+}
+
+template <class Matcher>
+typename TemplateIndex<Matcher>::Match TemplateIndex<Matcher>::identify(const Gesture &probe)
+{
+    Match match = {NO_MATCH, 0, 0, 0};
+    uint32_t best_cost = Matcher::ACCEPT_COST;
+
+    typename Matcher::Features features;
+    Matcher::features(probe, features);
+
+    for (int e = 0; e < count; ++e)
+    {
+        uint32_t bound = Matcher::bound(probe, features, entries[e].gesture, entries[e].features, best_cost);
+        entries[e].bound = bound < best_cost ? bound : PRUNED;
+        match.bounded += bound < best_cost;
+    }
+
+    if (Matcher::ORDERED)
+    {
+        // best bound first: a good match early tightens the limit for the
+        // rest, and nothing beats a cost of 0
+        int e;
+        while (best_cost > 0 && (e = next_candidate(best_cost - 1)) >= 0)
+        {
+            evaluate(e, probe, features, best_cost, match);
+        }
+    }
+    else
+    {
+        for (int e = 0; e < count && best_cost > 0; ++e)
+        {
+            if (entries[e].bound < best_cost)
+            {
+                evaluate(e, probe, features, best_cost, match);
+            }
+        }
+    }
+
+    if (match.id != NO_MATCH)
+    {
+        match.similarity = Matcher::similarity(best_cost);
+        if (match.similarity <= ACCEPT_THRESHOLD)
+        {
+            match.id = NO_MATCH;
+        }
+    }
+    return match;
+}
+
+template class TemplateIndex<WeightedMatcher>;
+template class TemplateIndex<DtwMatcher>;
+template class TemplateIndex<CorrelationMatcher>;
+template class TemplateIndex<SpectralMatcher>;
@@ -0,0 +1,63 @@
+#ifndef TEMPLATE_INDEX_HPP
+#define TEMPLATE_INDEX_HPP
+
+#include <cstdint>
+
+#include "match_policy.hpp"
+#include "matcher.hpp"
+
+// 1:N identification over the enrolled gestures with the Matcher policy of
+// match_policy.hpp. Each entry keeps what the policy's bound needs next to
+// the gesture. A search bounds every entry cheaply, then runs the full
+// matcher in best-bound-first order and stops as soon as no remaining bound
+// can beat the best cost, so the number of full comparisons grows much
+// slower than the number of templates.
+//
+// Storage is provided by the owner so the same code serves the device's few
+// slots and host benchmarks with hundreds of templates. Member functions live
+// in template_index.cpp, which instantiates every policy.
+template <class Matcher>
+class TemplateIndex
+{
+public:
+    struct Entry
+    {
+        int id;
+        Gesture gesture;
+        typename Matcher::Features features;
+        uint32_t bound; // search scratch, lower is more promising
+    };
+
+    struct Match
+    {
+        int id;             // best entry above ACCEPT_THRESHOLD, NO_MATCH if none
+        int32_t similarity; // Q15 score of the best entry, 0 if none
+        int bounded;        // entries that survived the cheapest bound
+        int evaluated;      // entries that needed the full matcher
+    };
+
+    static const int NO_MATCH = -1;
+
+    TemplateIndex(Entry *storage, int capacity);
+
+    void clear();
+
+    // adds or replaces the entry for `id`; false when full
+    bool add(int id, const Gesture &gesture);
+    int size() const;
+
+    Match identify(const Gesture &probe);
+
+private:
+    Entry *entries;
+    int capacity;
+    int count = 0;
+
+    int next_candidate(uint32_t limit) const; // smallest bound not above limit, -1 if none
+
+    // fully compares entry e, keeping it if it beats best_cost
+    void evaluate(int e, const Gesture &probe, const typename Matcher::Features &features, uint32_t &best_cost,
+                  Match &match);
+};
+
+#endif // TEMPLATE_INDEX_HPP
@@ -0,0 +1,256 @@
+#include "template_store.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+static const uint32_t MAGIC = 0x47535452; // "GSTR"
+
+// CRC-16/CCITT-FALSE, nibble table keeps it small and quick enough for a block
+uint16_t crc16(const uint8_t *data, uint32_t len, uint16_t crc)
+{
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+    }
+    return crc;
+}
+
+TemplateStore::TemplateStore(Storage &storage, uint32_t base) : storage(storage), base(base)
+{
+    for (int s = 0; s < SLOTS; ++s)
+    {
+        slots[s].block = -1;
+        slots[s].sequence = 0;
+    }
+}
+
+uint32_t TemplateStore::block_addr(int slot, int copy) const
+{
+    return base + (uint32_t)(slot * COPIES + copy) * BLOCK_SIZE;
+}
+
+uint32_t TemplateStore::end() const
+{
+    return block_addr(SLOTS, 0);
+}
+
+bool TemplateStore::read_header(int slot, int copy, Header &header)
+{
+    if (!storage.read(block_addr(slot, copy), (uint8_t *)&header, sizeof(header)))
+    {
+        return false;
+    }
+
+    return header.magic == MAGIC &&
+           header.version == VERSION &&
+           header.slot == slot &&
+           header.samples == SAMPLES &&
+           header.sequence != 0 &&
+           header.header_crc == crc16((const uint8_t *)&header, offsetof(Header, header_crc));
+}
+
+bool TemplateStore::mount()
+{
+    // blocks must start on a page, so no page is shared between two of them
+    const uint32_t page = storage.page_size();
+    if (end() > storage.size() || base % page != 0 || BLOCK_SIZE % page != 0)
+    {
+        return false;
+    }
+
+    for (int s = 0; s < SLOTS; ++s)
+    {
+        slots[s].block = -1;
+        slots[s].sequence = 0;
+
+        for (int c = 0; c < COPIES; ++c)
+        {
+            Header header;
+            if (read_header(s, c, header) && header.sequence > slots[s].sequence)
+            {
+                slots[s].block = (int8_t)c;
+                slots[s].sequence = header.sequence;
+            }
+        }
+
+        if (slots[s].sequence >= next_sequence)
+        {
+            next_sequence = slots[s].sequence + 1;
+        }
+    }
+
+    return true;
+}
+
+bool TemplateStore::has(int slot) const
+{
+    return slot >= 0 && slot < SLOTS && slots[slot].block >= 0;
+}
+
+int TemplateStore::next_slot() const
+{
+    int oldest = 0;
+    for (int s = 0; s < SLOTS; ++s)
+    {
+        if (slots[s].block < 0)
+        {
+            return s;
+        }
+        if (slots[s].sequence < slots[oldest].sequence)
+        {
+            oldest = s;
+        }
+    }
+    return oldest;
+}
+
+bool TemplateStore::load(int slot, Gesture &out)
+{
+    while (has(slot))
+    {
+        int copy = slots[slot].block;
+        uint8_t block[BLOCK_SIZE];
+        Header header;
+
+        if (read_header(slot, copy, header) &&
+            storage.read(block_addr(slot, copy) + sizeof(Header), block, 3 * SAMPLES) &&
+            header.payload_crc == crc16(block, 3 * SAMPLES))
+        {
+            const int8_t *q7 = (const int8_t *)block;
+            for (int k = 0; k < 3; ++k)
+            {
+                for (int i = 0; i < SAMPLES; ++i)
+                {
+                    out.axis[k][i] = (q15_t)(q7[k * SAMPLES + i] * (1 << header.shift));
+                }
+            }
+            return true;
+        }
+
+        // the newest copy is damaged: fall back to the next older valid one
+        slots[slot].block = -1;
+        uint32_t newest = 0;
+        for (int c = 0; c < COPIES; ++c)
+        {
+            if (c != copy && read_header(slot, c, header) && header.sequence < slots[slot].sequence &&
+                header.sequence > newest)
+            {
+                newest = header.sequence;
+                slots[slot].block = (int8_t)c;
+            }
+        }
+        slots[slot].sequence = newest;
+    }
+
+    return false;
+}
+
+bool TemplateStore::write_block(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    // split on absolute page boundaries: the payload starts mid-page
+    const uint32_t page = storage.page_size();
+    for (uint32_t offset = 0; offset < len;)
+    {
+        uint32_t room = page - (addr + offset) % page;
+        uint32_t chunk = len - offset < room ? len - offset : room;
+        if (!storage.write(addr + offset, data + offset, chunk))
+        {
+            return false;
+        }
+        offset += chunk;
+    }
+    return true;
+}
+
+bool TemplateStore::save(int slot, const Gesture &gesture)
+{
+    if (slot < 0 || slot >= SLOTS)
+    {
+        return false;
+    }
+
+    // smallest shift that brings every sample into int8
+    int32_t peak = 0;
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            int32_t magnitude = gesture.axis[k][i] < 0 ? -gesture.axis[k][i] : gesture.axis[k][i];
+            peak = magnitude > peak ? magnitude : peak;
+        }
+    }
+    uint8_t shift = 0;
+    while ((peak >> shift) > 127)
+    {
+        shift++;
+    }
+
+    uint8_t block[BLOCK_SIZE];
+    memset(block, 0xFF, sizeof(block));
+
+    int8_t *q7 = (int8_t *)(block + sizeof(Header));
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            int32_t rounded = shift ? (gesture.axis[k][i] + (1 << (shift - 1))) >> shift : gesture.axis[k][i];
+            q7[k * SAMPLES + i] = (int8_t)(rounded > 127 ? 127 : rounded);
+        }
+    }
+
+    Header header;
+    header.magic = MAGIC;
+    header.sequence = next_sequence;
+    header.version = VERSION;
+    header.slot = (uint8_t)slot;
+    header.samples = SAMPLES;
+    header.shift = shift;
+    header.payload_crc = crc16((const uint8_t *)q7, 3 * SAMPLES);
+    header.header_crc = crc16((const uint8_t *)&header, offsetof(Header, header_crc));
+
+    // rotate through the slot's copies; the target is never the newest one
+    int copy = (slots[slot].block + 1) % COPIES;
+    uint32_t addr = block_addr(slot, copy);
+
+    // invalidate the old header first and commit the new one last, so a
+    // reset mid-write can only ever lose this save, never the previous one
+    uint8_t blank[sizeof(Header)];
+    memset(blank, 0, sizeof(blank));
+    if (!write_block(addr, blank, sizeof(blank)) ||
+        !write_block(addr + sizeof(Header), block + sizeof(Header), BLOCK_SIZE - sizeof(Header)) ||
+        !write_block(addr, (const uint8_t *)&header, sizeof(Header)))
+    {
+        return false;
+    }
+
+    slots[slot].block = (int8_t)copy;
+    slots[slot].sequence = next_sequence++;
+    return true;
+}
+
+bool TemplateStore::erase(int slot)
+{
+    if (!has(slot))
+    {
+        return false;
+    }
+
+    uint8_t blank[sizeof(Header)];
+    memset(blank, 0, sizeof(blank));
+    for (int c = 0; c < COPIES; ++c)
+    {
+        if (!write_block(block_addr(slot, c), blank, sizeof(blank)))
+        {
+            return false;
+        }
+    }
+
+    slots[slot].block = -1;
+    slots[slot].sequence = 0;
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef TEMPLATE_STORE_HPP
+#define TEMPLATE_STORE_HPP
+
+#include <cstdint>
+
+#include "matcher.hpp"
+#include "storage.hpp"
+
+// Versioned, CRC-checked gesture templates in non-volatile storage.
+//
+// Every slot owns COPIES blocks used as a ring: a save goes to the block after
+// the newest one, so repeated re-enrollment spreads wear evenly, and a torn
+// write leaves the previous copy intact. A block is a 16-byte header followed
+// by the samples quantized to int8 with a per-template shift.
+//
+// mount() only reads and checks headers; samples are read and verified by
+// load() the first time a slot is actually needed.
+class TemplateStore
+{
+public:
+    static const int SLOTS = 8;
+    static const int COPIES = 4;
+    static const uint32_t BLOCK_SIZE = 128; // a multiple of the page size, up to 128-byte pages
+
+    static const uint8_t VERSION = 1;
+
+    TemplateStore(Storage &storage, uint32_t base = 0);
+
+    // false if the store does not fit, or `base` and BLOCK_SIZE are not
+    // multiples of the device's page size
+    bool mount();
+
+    bool has(int slot) const;
+
+    // where a new enrollment goes: the first empty slot, or once all are
+    // taken the one saved longest ago
+    int next_slot() const;
+    bool load(int slot, Gesture &out);
+    bool save(int slot, const Gesture &gesture);
+    bool erase(int slot);
+
+    // first address past the store, for other records sharing the device
+    uint32_t end() const;
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t sequence;   // higher is newer, 0 means never written
+        uint8_t version;
+        uint8_t slot;
+        uint8_t samples;
+        uint8_t shift;       // q15 = q7 << shift
+        uint16_t payload_crc;
+        uint16_t header_crc; // over the bytes above
+    };
+
+    static_assert(sizeof(Header) == 16, "header layout must stay stable");
+    static_assert(sizeof(Header) + 3 * SAMPLES <= BLOCK_SIZE, "template does not fit a block");
+
+    struct SlotState
+    {
+        int8_t block;  // newest valid copy, -1 if none
+        uint32_t sequence;
+    };
+
+    Storage &storage;
+    uint32_t base;
+    SlotState slots[SLOTS];
+    uint32_t next_sequence = 1;
+
+    uint32_t block_addr(int slot, int copy) const;
+    bool read_header(int slot, int copy, Header &header);
+    bool write_block(uint32_t addr, const uint8_t *data, uint32_t len);
+};
+
+uint16_t crc16(const uint8_t *data, uint32_t len, uint16_t crc = 0xFFFF);
+
+#endif // TEMPLATE_STORE_HPP
@@ -0,0 +1,70 @@
+#include "text_format.hpp"
+
+// digits of `magnitude`, most significant first, at least `min_digits` of them
+static char *put_digits(char *out, uint32_t magnitude, int min_digits)
+{
+    char reversed[10];
+    int count = 0;
+    do
+    {
+        reversed[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    while (count < min_digits)
+    {
+        *out++ = '0';
+        min_digits--;
+    }
+    while (count > 0)
+    {
+        *out++ = reversed[--count];
+    }
+    *out = '\0';
+    return out;
+}
+
+// the magnitude as unsigned so INT32_MIN needs no special case
+static uint32_t put_sign(char *&out, int32_t value)
+{
+    if (value < 0)
+    {
+        *out++ = '-';
+        return 0u - (uint32_t)value;
+    }
+    return (uint32_t)value;
+}
+
+char *format_text(char *out, const char *text)
+{
+    while (*text)
+    {
+        *out++ = *text++;
+    }
+    *out = '\0';
+    return out;
+}
+
+char *format_int(char *out, int32_t value)
+{
+    uint32_t magnitude = put_sign(out, value);
+    return put_digits(out, magnitude, 1);
+}
+
+char *format_fixed(char *out, int32_t value, int decimals)
+{
+    uint32_t scale = 1;
+    for (int i = 0; i < decimals; ++i)
+    {
+        scale *= 10;
+    }
+
+    uint32_t magnitude = put_sign(out, value);
+    out = put_digits(out, magnitude / scale, 1);
+    if (decimals > 0)
+    {
+        *out++ = '.';
+        out = put_digits(out, magnitude % scale, decimals);
+    }
+    return out;
+}
@@ -0,0 +1,22 @@
+#ifndef TEXT_FORMAT_HPP
+#define TEXT_FORMAT_HPP
+
+#include <cstdint>
+
+// Allocation-free formatting for the live readouts, with no printf and no
+// floats. Each function writes at `out`, NUL-terminates and returns a
+// pointer to the terminator, so calls chain:
+//
+//   format_int(format_text(format_int(format_text(buf, "x="), x), " y="), y);
+//
+// The caller sizes the buffer: an int32 takes at most 11 characters.
+
+char *format_text(char *out, const char *text);
+
+char *format_int(char *out, int32_t value);
+
+// `value` in units of 10^-decimals, printed like "%.*f": -5 with 2 decimals
+// is "-0.05"
+char *format_fixed(char *out, int32_t value, int decimals);
+
+#endif // TEXT_FORMAT_HPP
@@ -0,0 +1,122 @@
+#include "touch_input.hpp"
+
+#include "profiler.hpp"
+
+TouchInput::TouchInput(Touch &touch, EventLoop &events, const HitTarget *targets, int count)
+    : ts(touch), events(events), targets(targets), target_count(count)
+{
+}
+
+bool TouchInput::start()
+{
+    if (ts.AttachInterrupt(on_interrupt, this))
+    {
+        return true;
+    }
+    events.call_every(HOLD_POLL_MS, on_read, this);
+    return false;
+}
+
+void TouchInput::set_contact_handler(EventHandler handler, void *context)
+{
+    contact_handler = handler;
+    contact_context = context;
+}
+
+bool TouchInput::poll(TouchEvent &event)
+{
+    return queue.pop(event);
+}
+
+int TouchInput::hit_test(uint16_t x, uint16_t y) const
+{
+    for (int i = 0; i < target_count; ++i)
+    {
+        const Rect &r = targets[i].area;
+        if (x >= r.x && x < r.x + r.width && y >= r.y && y < r.y + r.height)
+        {
+            return targets[i].id;
+        }
+    }
+    return TOUCH_NONE;
+}
+
+void TouchInput::on_interrupt(void *input)
+{
+    TouchInput &self = *static_cast<TouchInput *>(input);
+
+    // a bouncing contact raises a burst of interrupts; one read covers them
+    if (!self.read_pending.exchange(true))
+    {
+        self.events.call_in(0, on_read, input);
+    }
+}
+
+void TouchInput::on_read(void *input)
+{
+    TouchInput &self = *static_cast<TouchInput *>(input);
+    self.read_pending = false;
+    self.changed(self.read());
+}
+
+void TouchInput::on_settle(void *input)
+{
+    TouchInput &self = *static_cast<TouchInput *>(input);
+    self.settle_event = 0;
+    self.settle();
+}
+
+void TouchInput::on_hold(void *input)
+{
+    TouchInput &self = *static_cast<TouchInput *>(input);
+    self.hold_event = 0;
+    self.changed(self.read());
+}
+
+TouchState TouchInput::read()
+{
+    PROFILE_SCOPE(PROF_TOUCH_POLL);
+    TouchState state;
+    ts.GetState(&state);
+    ts.ClearInterrupt();
+    return state;
+}
+
+void TouchInput::changed(const TouchState &state)
+{
+    if (state.touched != down && contact_handler)
+    {
+        contact_handler(contact_context);
+    }
+    if (state.touched)
+    {
+        contact = state;
+    }
+    if (state.touched != down && settle_event == 0)
+    {
+        // only a change that is still there after DEBOUNCE_MS counts
+        settle_event = events.call_in(DEBOUNCE_MS, on_settle, this);
+    }
+    if (down && hold_event == 0 && settle_event == 0)
+    {
+        hold_event = events.call_in(HOLD_POLL_MS, on_hold, this);
+    }
+}
+
+void TouchInput::settle()
+{
+    TouchState state = read();
+    if (state.touched != down)
+    {
+        down = state.touched;
+
+        // a release reports where the finger was last seen
+        TouchEvent event;
+        event.type = down ? TouchEvent::PRESS : TouchEvent::RELEASE;
+        event.x = down ? state.x : contact.x;
+        event.y = down ? state.y : contact.y;
+        event.target = hit_test(event.x, event.y);
+        queue.push(event);
+    }
+    changed(state);
+}
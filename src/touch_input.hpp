@@ -0,0 +1,87 @@
+#ifndef TOUCH_INPUT_HPP
+#define TOUCH_INPUT_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "hal.hpp"
+#include "spsc_ring.hpp"
+
+// A touchable area in panel coordinates and the id reported when it is hit
+struct HitTarget
+{
+    int id;
+    Rect area;
+};
+
+struct TouchEvent
+{
+    enum Type
+    {
+        PRESS,
+        RELEASE
+    };
+
+    Type type;
+    int target; // HitTarget id under the press, TOUCH_NONE if nothing
+    uint16_t x, y;
+};
+
+constexpr int TOUCH_NONE = -1;
+
+// Interrupt-driven touch input. The controller's interrupt only schedules a
+// read on the event loop, so nothing talks to the panel while it is idle. A
+// change of contact has to hold for DEBOUNCE_MS before it becomes a PRESS or
+// RELEASE, so a bouncing finger yields exactly one of each. While a finger
+// is down the panel is also checked every HOLD_POLL_MS in case a release
+// interrupt is lost. Presses are hit-tested against a fixed table.
+class TouchInput
+{
+public:
+    static const uint32_t DEBOUNCE_MS = 20;
+    static const uint32_t HOLD_POLL_MS = 50;
+    static const size_t QUEUE_SIZE = 8;
+
+    TouchInput(Touch &touch, EventLoop &events, const HitTarget *targets, int count);
+
+    // hooks the interrupt; without one the panel is polled every HOLD_POLL_MS
+    bool start();
+
+    // Called on the event loop as soon as the controller reports a change of
+    // contact, before debouncing: the earliest sign that someone is there.
+    void set_contact_handler(EventHandler handler, void *context);
+
+    // next debounced event, false when none is queued
+    bool poll(TouchEvent &event);
+
+    // what lies under a point, TOUCH_NONE if nothing
+    int hit_test(uint16_t x, uint16_t y) const;
+
+private:
+    Touch &ts;
+    EventLoop &events;
+    const HitTarget *targets;
+    int target_count;
+
+    SpscRing<TouchEvent, QUEUE_SIZE> queue;
+
+    std::atomic<bool> read_pending{false}; // an interrupt already scheduled a read
+    bool down = false;     // debounced contact
+    int settle_event = 0;  // pending debounce check, 0 when none
+    int hold_event = 0;    // pending release check while pressed, 0 when none
+    TouchState contact = {}; // last reading with a finger down
+
+    EventHandler contact_handler = nullptr;
+    void *contact_context = nullptr;
+
+    static void on_interrupt(void *input); // interrupt context
+    static void on_read(void *input);
+    static void on_settle(void *input);
+    static void on_hold(void *input);
+
+    TouchState read(); // one controller access, acknowledging its interrupt
+    void changed(const TouchState &state);
+    void settle();
+};
+
+#endif // TOUCH_INPUT_HPP
@@ -0,0 +1,184 @@
+// The Q14 low-pass cascade against a double precision reference:
+//   pio test -e test -f test_filter_bank
+//
+// The host build takes the plain integer path, which the SMLAD one matches
+// bit for bit.
+
+#include <unity.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include "filter_bank.hpp"
+
+static const uint32_t ODRS[] = {100, 200, 400, 800};
+static const int LENGTH = 4096; // full-rate samples per run
+static const int SETTLE = 1024; // samples after which a constant input has passed through
+static const double TOLERANCE = 4.0; // LSB the rounding may drift from the reference
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static int16_t input[LENGTH];
+static int16_t output[LENGTH];
+static double reference[LENGTH];
+
+// filters `input` on all three axes and returns the decimated x outputs
+static int run_bank(uint32_t odr_hz)
+{
+    FilterBank bank(odr_hz);
+    GyroData block[FilterBank::BLOCK], filtered[FilterBank::BLOCK];
+    int written = 0;
+    for (int begin = 0; begin < LENGTH; begin += (int)FilterBank::BLOCK)
+    {
+        for (size_t i = 0; i < FilterBank::BLOCK; ++i)
+        {
+            block[i].x_raw = block[i].y_raw = block[i].z_raw = input[begin + i];
+        }
+        size_t count = bank.process(block, FilterBank::BLOCK, filtered);
+        for (size_t i = 0; i < count; ++i)
+        {
+            TEST_ASSERT_EQUAL_INT16(filtered[i].x_raw, filtered[i].y_raw);
+            TEST_ASSERT_EQUAL_INT16(filtered[i].x_raw, filtered[i].z_raw);
+            output[written++] = filtered[i].x_raw;
+        }
+    }
+    return written;
+}
+
+// the same recurrence with the same Q14 coefficients, without rounding; a
+// section saturates between sections like the fixed point one does
+static void run_reference(uint32_t odr_hz)
+{
+    for (int i = 0; i < LENGTH; ++i)
+    {
+        reference[i] = input[i];
+    }
+    const Biquad *sections = FilterBank::low_pass(odr_hz);
+    for (int s = 0; s < FilterBank::SECTIONS; ++s)
+    {
+        const Biquad &c = sections[s];
+        double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+        for (int i = 0; i < LENGTH; ++i)
+        {
+            double x0 = reference[i];
+            double y0 = (c.b0 * x0 + c.b1 * x1 + c.b2 * x2 + c.a1 * y1 + c.a2 * y2) / 16384.0;
+            y0 = y0 > INT16_MAX ? INT16_MAX : y0 < INT16_MIN ? INT16_MIN : y0;
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y0;
+            reference[i] = y0;
+        }
+    }
+}
+
+static void test_sections_have_unity_dc_gain_and_cannot_overflow()
+{
+    for (uint32_t odr : ODRS)
+    {
+        const Biquad *sections = FilterBank::low_pass(odr);
+        for (int s = 0; s < FilterBank::SECTIONS; ++s)
+        {
+            const Biquad &c = sections[s];
+            // y = x is a fixed point of the recurrence exactly when this holds
+            TEST_ASSERT_EQUAL(1 << 14, c.b0 + c.b1 + c.b2 + c.a1 + c.a2);
+            // with every term at full scale the accumulator stays in 32 bits
+            int32_t magnitude = abs(c.b0) + abs(c.b1) + abs(c.b2) + abs(c.a1) + abs(c.a2);
+            TEST_ASSERT_TRUE(magnitude < (1 << 16));
+        }
+    }
+}
+
+static void test_constant_input_settles_to_itself()
+{
+    static const int16_t LEVELS[] = {0, 1, -1, 1000, -12345, INT16_MAX, INT16_MIN};
+    for (uint32_t odr : ODRS)
+    {
+        for (int16_t level : LEVELS)
+        {
+            for (int i = 0; i < LENGTH; ++i)
+            {
+                input[i] = level;
+            }
+            int written = run_bank(odr);
+            for (int i = SETTLE * (int)FilterBank::OUTPUT_HZ / (int)odr; i < written; ++i)
+            {
+                TEST_ASSERT_EQUAL_INT16(level, output[i]);
+            }
+        }
+    }
+}
+
+static void test_matches_the_double_reference()
+{
+    for (uint32_t odr : ODRS)
+    {
+        // a chirp from 1 Hz to well past the cutoff, at half scale
+        double phase = 0.0;
+        for (int i = 0; i < LENGTH; ++i)
+        {
+            double hz = 1.0 + 60.0 * i / LENGTH;
+            phase += 2.0 * M_PI * hz / odr;
+            input[i] = (int16_t)lrint(16000.0 * sin(phase));
+        }
+        int written = run_bank(odr);
+        run_reference(odr);
+
+        int decimation = (int)(odr / FilterBank::OUTPUT_HZ);
+        double worst = 0.0;
+        for (int i = 0; i < written; ++i)
+        {
+            double error = fabs(output[i] - reference[i * decimation]);
+            worst = error > worst ? error : worst;
+        }
+        TEST_ASSERT_DOUBLE_WITHIN(TOLERANCE, 0.0, worst);
+    }
+}
+
+static void test_full_scale_square_wave_only_clips_its_overshoot()
+{
+    for (uint32_t odr : ODRS)
+    {
+        // 2.5 Hz, slow enough for every edge to settle
+        int half_period = (int)odr / 5;
+        for (int i = 0; i < LENGTH; ++i)
+        {
+            input[i] = (i / half_period) % 2 ? -INT16_MAX : INT16_MAX;
+        }
+        int written = run_bank(odr);
+        run_reference(odr);
+
+        int decimation = (int)(odr / FilterBank::OUTPUT_HZ);
+        int clipped = 0;
+        for (int i = 0; i < written; ++i)
+        {
+            double expected = reference[i * decimation];
+            // overflow would wrap to the other rail, far from the reference
+            TEST_ASSERT_DOUBLE_WITHIN(TOLERANCE, expected, output[i]);
+            // the rails are reached only where the Butterworth overshoot
+            // takes the reference there too
+            if (output[i] == INT16_MAX || output[i] == INT16_MIN)
+            {
+                TEST_ASSERT_TRUE(fabs(expected) >= INT16_MAX - TOLERANCE);
+                clipped++;
+            }
+        }
+        TEST_ASSERT_TRUE(clipped > 0); // every edge rings past full scale
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sections_have_unity_dc_gain_and_cannot_overflow);
+    RUN_TEST(test_constant_input_settles_to_itself);
+    RUN_TEST(test_matches_the_double_reference);
+    RUN_TEST(test_full_scale_square_wave_only_clips_its_overshoot);
+    return UNITY_END();
+}
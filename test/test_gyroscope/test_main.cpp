@@ -0,0 +1,186 @@
+// Gyroscope FIFO handling against the register model in MockSpiBus:
+//   pio test -e test -f test_gyroscope
+
+#include <unity.h>
+
+#include "gyroscope.hpp"
+#include "mock_spi_bus.hpp"
+
+static const uint8_t CTRL_REG3 = 0x22;
+static const uint8_t CTRL_REG5 = 0x24;
+static const uint8_t FIFO_CTRL_REG = 0x2E;
+
+static MockSpiBus *bus;
+static Gyro *gyro;
+
+void setUp()
+{
+    bus = new MockSpiBus();
+    gyro = new Gyro(*bus);
+    TEST_ASSERT_TRUE(gyro->init());
+    gyro->calibrated = false; // raw counts come out unchanged
+}
+
+void tearDown()
+{
+    delete gyro;
+    delete bus;
+}
+
+// sample i of a stream that tells every axis and position apart
+static void push(int count, int first = 0)
+{
+    for (int i = first; i < first + count; ++i)
+    {
+        bus->push_sample((int16_t)(100 * i + 1), (int16_t)(-100 * i - 2), (int16_t)(1000 + i));
+    }
+}
+
+static void check_sample(const GyroData &data, int i)
+{
+    TEST_ASSERT_EQUAL_INT16(100 * i + 1, data.x_raw);
+    TEST_ASSERT_EQUAL_INT16(-100 * i - 2, data.y_raw);
+    TEST_ASSERT_EQUAL_INT16(1000 + i, data.z_raw);
+}
+
+static void test_enable_fifo_writes_stream_mode_and_watermark()
+{
+    TEST_ASSERT_TRUE(gyro->enable_fifo(8));
+
+    TEST_ASSERT_EQUAL_HEX8(0x04, bus->reg(CTRL_REG3));          // watermark on INT2
+    TEST_ASSERT_EQUAL_HEX8(0x40 | 8, bus->reg(FIFO_CTRL_REG));   // stream mode, WTM = 8
+    TEST_ASSERT_EQUAL_HEX8(GyroConfig::CTRL_REG5 | 0x40, bus->reg(CTRL_REG5));
+
+    gyro->disable_fifo();
+    TEST_ASSERT_EQUAL_HEX8(0x00, bus->reg(CTRL_REG3));
+    TEST_ASSERT_EQUAL_HEX8(0x00, bus->reg(FIFO_CTRL_REG));
+    TEST_ASSERT_EQUAL_HEX8(GyroConfig::CTRL_REG5, bus->reg(CTRL_REG5));
+}
+
+static void test_enable_fifo_rejects_watermarks_out_of_range()
+{
+    TEST_ASSERT_FALSE(gyro->enable_fifo(0));
+    TEST_ASSERT_FALSE(gyro->enable_fifo(Gyro::FIFO_DEPTH));
+    TEST_ASSERT_EQUAL_HEX8(0x00, bus->reg(FIFO_CTRL_REG));
+    TEST_ASSERT_EQUAL_HEX8(GyroConfig::CTRL_REG5, bus->reg(CTRL_REG5));
+}
+
+static void test_watermark_drain_reads_every_sample_in_one_burst()
+{
+    TEST_ASSERT_TRUE(gyro->enable_fifo(8));
+    push(8);
+    TEST_ASSERT_EQUAL(8, gyro->fifo_level());
+
+    GyroData out[Gyro::FIFO_DEPTH];
+    unsigned before = bus->transactions;
+    TEST_ASSERT_EQUAL(8, gyro->read_fifo(out, Gyro::FIFO_DEPTH));
+    TEST_ASSERT_EQUAL(2, bus->transactions - before); // FIFO_SRC_REG, then the burst
+
+    for (int i = 0; i < 8; ++i)
+    {
+        check_sample(out[i], i);
+    }
+    TEST_ASSERT_EQUAL(0, gyro->fifo_level());
+    TEST_ASSERT_FALSE(gyro->fifo_overrun);
+}
+
+static void test_burst_wraps_from_out_z_h_to_out_x_l()
+{
+    TEST_ASSERT_TRUE(gyro->enable_fifo(4));
+    push(5);
+
+    // a short capacity leaves the rest queued, in order
+    GyroData out[Gyro::FIFO_DEPTH];
+    TEST_ASSERT_EQUAL(3, gyro->read_fifo(out, 3));
+    for (int i = 0; i < 3; ++i)
+    {
+        check_sample(out[i], i);
+    }
+    TEST_ASSERT_EQUAL(2, bus->level());
+
+    TEST_ASSERT_EQUAL(2, gyro->read_fifo(out, Gyro::FIFO_DEPTH));
+    check_sample(out[0], 3);
+    check_sample(out[1], 4);
+}
+
+static void test_async_drain_matches_blocking_drain()
+{
+    TEST_ASSERT_TRUE(gyro->enable_fifo(8));
+    push(12);
+
+    // the mock completes synchronously, so the callback has run on return
+    static int completions;
+    completions = 0;
+    gyro->read_fifo_async([](void *) { completions++; }, nullptr);
+    TEST_ASSERT_EQUAL(1, completions);
+
+    GyroData out[Gyro::FIFO_DEPTH];
+    TEST_ASSERT_EQUAL(12, gyro->fifo_result(out, Gyro::FIFO_DEPTH));
+    for (int i = 0; i < 12; ++i)
+    {
+        check_sample(out[i], i);
+    }
+}
+
+static void test_failed_drain_yields_no_samples()
+{
+    TEST_ASSERT_TRUE(gyro->enable_fifo(8));
+    GyroData out[Gyro::FIFO_DEPTH];
+
+    // a failed status read leaves the FIFO alone for the next drain
+    push(8);
+    bus->fail_mask = 0x1;
+    gyro->read_fifo_async(nullptr, nullptr);
+    TEST_ASSERT_EQUAL(0, gyro->fifo_result(out, Gyro::FIFO_DEPTH));
+    TEST_ASSERT_EQUAL(8, gyro->fifo_level());
+
+    // a failed burst has emptied the FIFO, but its bytes are not trusted
+    bus->fail_mask = 0x2;
+    gyro->read_fifo_async(nullptr, nullptr);
+    TEST_ASSERT_EQUAL(0, gyro->fifo_result(out, Gyro::FIFO_DEPTH));
+    TEST_ASSERT_EQUAL(0, gyro->fifo_level());
+
+    // and the next drain is back to normal
+    push(4, 8);
+    gyro->read_fifo_async(nullptr, nullptr);
+    TEST_ASSERT_EQUAL(4, gyro->fifo_result(out, Gyro::FIFO_DEPTH));
+    check_sample(out[0], 8);
+}
+
+static void test_full_fifo_is_reported_through_ovrn()
+{
+    TEST_ASSERT_TRUE(gyro->enable_fifo(8));
+
+    // exactly full: FSS saturates at 31, OVRN makes it FIFO_DEPTH
+    push(Gyro::FIFO_DEPTH);
+    TEST_ASSERT_EQUAL(Gyro::FIFO_DEPTH, gyro->fifo_level());
+    TEST_ASSERT_TRUE(gyro->fifo_overrun);
+
+    // overrun: the oldest samples were overwritten, the newest 32 remain
+    push(8, Gyro::FIFO_DEPTH);
+    TEST_ASSERT_EQUAL(Gyro::FIFO_DEPTH, gyro->fifo_level());
+    TEST_ASSERT_TRUE(gyro->fifo_overrun);
+
+    GyroData out[Gyro::FIFO_DEPTH];
+    TEST_ASSERT_EQUAL(Gyro::FIFO_DEPTH, gyro->read_fifo(out, Gyro::FIFO_DEPTH));
+    for (int i = 0; i < Gyro::FIFO_DEPTH; ++i)
+    {
+        check_sample(out[i], 8 + i);
+    }
+
+    TEST_ASSERT_EQUAL(0, gyro->fifo_level());
+    TEST_ASSERT_FALSE(gyro->fifo_overrun);
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_enable_fifo_writes_stream_mode_and_watermark);
+    RUN_TEST(test_enable_fifo_rejects_watermarks_out_of_range);
+    RUN_TEST(test_watermark_drain_reads_every_sample_in_one_burst);
+    RUN_TEST(test_burst_wraps_from_out_z_h_to_out_x_l);
+    RUN_TEST(test_async_drain_matches_blocking_drain);
+    RUN_TEST(test_failed_drain_yields_no_samples);
+    RUN_TEST(test_full_fifo_is_reported_through_ovrn);
+    return UNITY_END();
+}
@@ -0,0 +1,94 @@
+// Q15 matchers against their float references:
+//   pio test -e test -f test_matcher
+
+#include <unity.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include "dtw.hpp"
+#include "matcher.hpp"
+
+static const int PAIRS = 2000;
+static const double SIMILARITY_TOLERANCE = 5e-5; // absolute, on a [0, 1] score
+static const double DTW_TOLERANCE = 0.002;       // relative to the float cost
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static q15_t clamp_q15(double value)
+{
+    double scaled = value * 32768.0;
+    return (q15_t)(scaled > 32767.0 ? 32767 : scaled < -32768.0 ? -32768 : lrint(scaled));
+}
+
+// the random wrist rotations tools/match_bench compares
+static void make_gesture(Gesture &out, double speed, double phase, double amplitude, unsigned seed)
+{
+    srand(seed);
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        double t = i * speed / SAMPLES;
+        double noise = ((rand() % 1000) - 500) / 50000.0;
+        out.axis[0][i] = clamp_q15(amplitude * 0.35 * sin(2 * M_PI * t + phase) + noise);
+        out.axis[1][i] = clamp_q15(amplitude * 0.20 * sin(4 * M_PI * t + phase) + noise);
+        out.axis[2][i] = clamp_q15(amplitude * 0.10 * cos(2 * M_PI * t + phase) + noise);
+    }
+}
+
+static void make_pair(int n, Gesture &a, Gesture &b)
+{
+    make_gesture(a, 0.8 + (n % 7) * 0.1, 0.0, 0.5 + (n % 5) * 0.5, 2 * n + 1);
+    make_gesture(b, 0.8 + (n % 3) * 0.2, (n % 4) * M_PI / 2, 0.5 + (n % 6) * 0.4, 2 * n + 2);
+}
+
+static void test_similarity_matches_float_reference()
+{
+    Gesture a, b;
+    double worst = 0.0;
+    for (int n = 0; n < PAIRS; ++n)
+    {
+        make_pair(n, a, b);
+        double error = fabs(calculate_similarity(a, b) / 32768.0 - reference_similarity(a, b));
+        worst = error > worst ? error : worst;
+    }
+    TEST_ASSERT_DOUBLE_WITHIN(SIMILARITY_TOLERANCE, 0.0, worst);
+}
+
+static void test_dtw_distance_matches_float_reference()
+{
+    Gesture a, b;
+    double worst = 0.0;
+    for (int n = 0; n < PAIRS; ++n)
+    {
+        make_pair(n, a, b);
+        double fixed = dtw_distance(a, b, DTW_BAND, DTW_INFINITY) / (double)(1 << 22);
+        double reference = reference_dtw_distance(a, b, DTW_BAND);
+        double error = fabs(fixed - reference) / (reference > 1e-3 ? reference : 1e-3);
+        worst = error > worst ? error : worst;
+    }
+    TEST_ASSERT_DOUBLE_WITHIN(DTW_TOLERANCE, 0.0, worst);
+}
+
+static void test_identical_gestures_score_one()
+{
+    Gesture a, b;
+    make_pair(3, a, b);
+    TEST_ASSERT_EQUAL(Q15_ONE, calculate_similarity(a, a));
+    TEST_ASSERT_EQUAL(0, dtw_distance(a, a, DTW_BAND, DTW_INFINITY));
+    TEST_ASSERT_EQUAL(Q15_ONE, dtw_similarity(b, b));
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_similarity_matches_float_reference);
+    RUN_TEST(test_dtw_distance_matches_float_reference);
+    RUN_TEST(test_identical_gestures_score_one);
+    return UNITY_END();
+}
@@ -0,0 +1,111 @@
+// Template store on EEPROMs with different page sizes:
+//   pio test -e test -f test_template_store
+
+#include <unity.h>
+
+#include "file_storage.hpp"
+#include "template_store.hpp"
+
+static const uint32_t STORAGE_SIZE = 8 * 1024;
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void make_gesture(Gesture &out, int seed)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            out.axis[k][i] = (q15_t)((i * 997 + k * 131 + seed * 61) % 2001 - 1000);
+        }
+    }
+}
+
+// what save() keeps: int8 with a shift of 3 for peaks of 1000
+static void check_gesture(const Gesture &expected, const Gesture &actual)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            TEST_ASSERT_INT_WITHIN(8, expected.axis[k][i], actual.axis[k][i]);
+        }
+    }
+}
+
+// the payload starts 16 bytes into a block, so with larger pages its writes
+// have to be split where the pages end
+static void check_round_trip(uint32_t page)
+{
+    FileStorage storage(STORAGE_SIZE, page);
+    TEST_ASSERT_TRUE(storage.open(nullptr));
+
+    Gesture saved[2], loaded;
+    make_gesture(saved[0], 1);
+    make_gesture(saved[1], 2);
+    {
+        TemplateStore store(storage);
+        TEST_ASSERT_TRUE(store.mount());
+        TEST_ASSERT_TRUE(store.save(0, saved[0]));
+        TEST_ASSERT_TRUE(store.save(TemplateStore::SLOTS - 1, saved[1]));
+        TEST_ASSERT_TRUE(store.save(0, saved[1])); // the slot's next copy
+    }
+
+    TemplateStore store(storage);
+    TEST_ASSERT_TRUE(store.mount());
+    TEST_ASSERT_TRUE(store.load(0, loaded));
+    check_gesture(saved[1], loaded);
+    TEST_ASSERT_TRUE(store.load(TemplateStore::SLOTS - 1, loaded));
+    check_gesture(saved[1], loaded);
+    TEST_ASSERT_FALSE(store.has(1));
+}
+
+static void test_round_trip_with_4_byte_pages()
+{
+    check_round_trip(4);
+}
+
+static void test_round_trip_with_32_byte_pages()
+{
+    check_round_trip(32);
+}
+
+static void test_round_trip_with_64_byte_pages()
+{
+    check_round_trip(64);
+}
+
+static void test_round_trip_with_128_byte_pages()
+{
+    check_round_trip(128);
+}
+
+static void test_mount_rejects_unaligned_layouts()
+{
+    FileStorage storage(STORAGE_SIZE, 32);
+    TEST_ASSERT_TRUE(storage.open(nullptr));
+
+    TEST_ASSERT_FALSE(TemplateStore(storage, 16).mount()); // base mid-page
+    TEST_ASSERT_TRUE(TemplateStore(storage, 32).mount());
+
+    FileStorage large_pages(STORAGE_SIZE, 256);
+    TEST_ASSERT_TRUE(large_pages.open(nullptr));
+    TEST_ASSERT_FALSE(TemplateStore(large_pages).mount()); // blocks would share pages
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_with_4_byte_pages);
+    RUN_TEST(test_round_trip_with_32_byte_pages);
+    RUN_TEST(test_round_trip_with_64_byte_pages);
+    RUN_TEST(test_round_trip_with_128_byte_pages);
+    RUN_TEST(test_mount_rejects_unaligned_layouts);
+    return UNITY_END();
+}
@@ -0,0 +1,611 @@
+// Host micro-benchmarks for the per-sample kernels: decoding FIFO bursts
+// through the gyro driver (byte combining, bias subtraction, dps scaling),
+// normalize(), both matchers, the always-on spotter with every template slot
+// taken and the live readout formatting next to the snprintf() it replaced.
+// Every kernel is run over a stream of N samples for N from one gesture's
+// worth up to thousands. Build and run with
+//   pio run -e kernel_bench && .pio/build/kernel_bench/program
+//       [--trace trace.csv] [--filter text] [--min-time 0.05] [--repetitions 3]
+//       [--out results.json] [--baseline baseline.json] [--tolerance 0.2]
+//
+// Without --trace the input is a synthetic wrist rotation; traces use the
+// simulation's CSV format and are cycled to the length a benchmark needs.
+//
+// Each benchmark is timed in repetitions of at least --min-time seconds and
+// the fastest one is kept. --out writes the results in Google Benchmark's
+// JSON layout, so its tooling can compare them too. --baseline reads such a
+// file back and exits with 1 if any benchmark got slower than its baseline by
+// more than --tolerance. Baselines only compare on the machine that wrote
+// them.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "dtw.hpp"
+#include "gesture_spotter.hpp"
+#include "gyroscope.hpp"
+#include "matcher.hpp"
+#include "mock_spi_bus.hpp"
+#include "text_format.hpp"
+
+static const long SAMPLE_COUNTS[] = {SAMPLES, 256, 1024, 4096};
+static const int SYNTHETIC_SAMPLES = 8192;
+static const uint8_t FIFO_WATERMARK = 8; // samples per burst, as the firmware drains them
+
+struct Sample
+{
+    int16_t x, y, z;
+};
+
+static std::vector<Sample> stream; // input of every benchmark, cycled
+
+static const Sample &sample(long i)
+{
+    return stream[i % stream.size()];
+}
+
+// keeps the compiler from discarding a result nobody reads
+template <typename T>
+static void keep(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Google Benchmark's KeepRunning(): the clocks run from the first call to
+// the one that returns false, so setup before the loop is not timed
+class State
+{
+public:
+    const long n; // samples per iteration
+
+    State(long n, long iterations) : n(n), iterations(iterations), left(iterations)
+    {
+    }
+
+    bool running()
+    {
+        if (left == iterations)
+        {
+            wall_start = std::chrono::steady_clock::now();
+            cpu_start = std::clock();
+        }
+        if (left-- > 0)
+        {
+            return true;
+        }
+        real_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall_start).count();
+        cpu_ns = (std::clock() - cpu_start) * 1e9 / CLOCKS_PER_SEC;
+        return false;
+    }
+
+    double real_ns = 0.0; // for all iterations
+    double cpu_ns = 0.0;
+
+private:
+    const long iterations;
+    long left;
+    std::chrono::steady_clock::time_point wall_start;
+    std::clock_t cpu_start = 0;
+};
+
+typedef void (*BenchmarkFn)(State &state);
+
+struct Benchmark
+{
+    const char *name;
+    BenchmarkFn fn;
+};
+
+struct Result
+{
+    std::string name;
+    long iterations;
+    double real_ns; // per iteration
+    double cpu_ns;
+    long items;     // samples per iteration
+};
+
+// ----- Kernels -----
+
+// N samples through the sensor FIFO, a watermark's worth per burst
+static void drain_fifo(State &state, bool calibrated)
+{
+    MockSpiBus bus;
+    Gyro gyro(bus);
+    if (!gyro.init() || !gyro.enable_fifo(FIFO_WATERMARK))
+    {
+        fprintf(stderr, "mock gyro did not take its configuration\n");
+        exit(1);
+    }
+    gyro.set_bias(12.5f, -7.25f, 3.0f);
+    gyro.calibrated = calibrated;
+
+    GyroData out[FIFO_WATERMARK];
+    while (state.running())
+    {
+        for (long done = 0; done < state.n;)
+        {
+            long burst = state.n - done < FIFO_WATERMARK ? state.n - done : FIFO_WATERMARK;
+            for (long i = 0; i < burst; ++i)
+            {
+                const Sample &s = sample(done + i);
+                bus.push_sample(s.x, s.y, s.z);
+            }
+            done += gyro.read_fifo(out, burst);
+            keep(out);
+        }
+    }
+}
+
+static void bm_read_fifo(State &state)
+{
+    drain_fifo(state, false);
+}
+
+static void bm_read_fifo_calibrated(State &state)
+{
+    drain_fifo(state, true);
+}
+
+// one chip select per sample, as polling the output registers would
+static void bm_read_gyro(State &state)
+{
+    MockSpiBus bus;
+    Gyro gyro(bus);
+    gyro.init();
+    gyro.set_bias(12.5f, -7.25f, 3.0f);
+    gyro.calibrated = true;
+
+    while (state.running())
+    {
+        for (long i = 0; i < state.n; ++i)
+        {
+            const Sample &s = sample(i);
+            bus.push_sample(s.x, s.y, s.z);
+            GyroData data = gyro.read_gyro();
+            keep(data);
+        }
+    }
+}
+
+static void bm_normalize(State &state)
+{
+    while (state.running())
+    {
+        for (long i = 0; i < state.n; ++i)
+        {
+            const Sample &s = sample(i);
+            q15_t xyz[3] = {normalize(s.x), normalize(s.y), normalize(s.z)};
+            keep(xyz);
+        }
+    }
+}
+
+// the stream cut into consecutive SAMPLES-point gestures
+static std::vector<Gesture> gestures_of(long n)
+{
+    std::vector<Gesture> gestures((n + SAMPLES - 1) / SAMPLES);
+    for (long i = 0; i < (long)gestures.size() * SAMPLES; ++i)
+    {
+        const Sample &s = sample(i);
+        Gesture &g = gestures[i / SAMPLES];
+        g.axis[0][i % SAMPLES] = normalize(s.x);
+        g.axis[1][i % SAMPLES] = normalize(s.y);
+        g.axis[2][i % SAMPLES] = normalize(s.z);
+    }
+    return gestures;
+}
+
+// every gesture of the stream scored against an enrolled one slightly offset
+// in time, so DTW has to warp rather than walk the diagonal
+static void score_stream(State &state, int32_t (*match)(const Gesture &, const Gesture &))
+{
+    std::vector<Gesture> probes = gestures_of(state.n);
+    Gesture enrolled = probes[0];
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int i = 0; i < SAMPLES; ++i)
+        {
+            enrolled.axis[k][i] = probes[0].axis[k][i < 2 ? 0 : i - 2];
+        }
+    }
+
+    while (state.running())
+    {
+        for (const Gesture &probe : probes)
+        {
+            int32_t score = match(enrolled, probe);
+            keep(score);
+        }
+    }
+}
+
+static void bm_calculate_similarity(State &state)
+{
+    score_stream(state, calculate_similarity);
+}
+
+static void bm_dtw_similarity(State &state)
+{
+    score_stream(state, dtw_similarity);
+}
+
+// the stream through the spotter with all of its templates enrolled, every
+// one cut from the stream itself so matches run and get reported
+static void bm_spotter_push(State &state)
+{
+    std::vector<Gesture> gestures = gestures_of(GestureSpotter::MAX_TEMPLATES * SAMPLES);
+    GestureSpotter spotter;
+    for (int t = 0; t < GestureSpotter::MAX_TEMPLATES; ++t)
+    {
+        spotter.add(t, gestures[t]);
+    }
+
+    GestureSpotter::Spot spot;
+    while (state.running())
+    {
+        for (long i = 0; i < state.n; ++i)
+        {
+            const Sample &s = sample(i);
+            GyroData data = {0, 0, 0, s.x, s.y, s.z};
+            bool found = spotter.push(data, spot);
+            keep(found);
+        }
+    }
+}
+
+// what App::display_xyz() shows per sample: dps with two decimals and raw
+static int32_t centi_dps(int16_t raw)
+{
+    int64_t scaled = (int64_t)raw * GyroConfig::SENSITIVITY_UDPS;
+    return (int32_t)((scaled + (scaled < 0 ? -5000 : 5000)) / 10000);
+}
+
+static void bm_format_readouts(State &state)
+{
+    char text[16];
+    while (state.running())
+    {
+        for (long i = 0; i < state.n; ++i)
+        {
+            const Sample &s = sample(i);
+            const int16_t raw[3] = {s.x, s.y, s.z};
+            for (int k = 0; k < 3; ++k)
+            {
+                format_fixed(text, centi_dps(raw[k]), 2);
+                keep(text);
+                format_int(text, raw[k]);
+                keep(text);
+            }
+        }
+    }
+}
+
+// the same readouts the way display_xyz() used to build them
+static void bm_sprintf_readouts(State &state)
+{
+    char text[16];
+    while (state.running())
+    {
+        for (long i = 0; i < state.n; ++i)
+        {
+            const Sample &s = sample(i);
+            const int16_t raw[3] = {s.x, s.y, s.z};
+            for (int k = 0; k < 3; ++k)
+            {
+                snprintf(text, sizeof(text), "%.2f", raw[k] * GyroConfig::SENSITIVITY);
+                keep(text);
+                snprintf(text, sizeof(text), "%d", raw[k]);
+                keep(text);
+            }
+        }
+    }
+}
+
+static const Benchmark BENCHMARKS[] = {
+    {"read_fifo", bm_read_fifo},
+    {"read_fifo_calibrated", bm_read_fifo_calibrated},
+    {"read_gyro", bm_read_gyro},
+    {"normalize", bm_normalize},
+    {"calculate_similarity", bm_calculate_similarity},
+    {"dtw_similarity", bm_dtw_similarity},
+    {"spotter_push", bm_spotter_push},
+    {"format_readouts", bm_format_readouts},
+    {"sprintf_readouts", bm_sprintf_readouts},
+};
+
+// ----- Runner -----
+
+// grows the iteration count until one repetition lasts min_time, then keeps
+// the fastest of `repetitions`
+static Result measure(const Benchmark &benchmark, long n, double min_time, int repetitions)
+{
+    long iterations = 1;
+    for (;;)
+    {
+        State state(n, iterations);
+        benchmark.fn(state);
+        if (state.real_ns >= min_time * 1e9 || iterations >= 1000000000L)
+        {
+            break;
+        }
+        // aim a little past min_time, at most 10x per step
+        double factor = state.real_ns > 0.0 ? min_time * 1e9 * 1.4 / state.real_ns : 10.0;
+        iterations = (long)(iterations * (factor > 10.0 ? 10.0 : factor < 2.0 ? 2.0 : factor));
+    }
+
+    Result best = {std::string(benchmark.name) + "/" + std::to_string(n), iterations, 0.0, 0.0, n};
+    for (int r = 0; r < repetitions; ++r)
+    {
+        State state(n, iterations);
+        benchmark.fn(state);
+        if (r == 0 || state.real_ns / iterations < best.real_ns)
+        {
+            best.real_ns = state.real_ns / iterations;
+            best.cpu_ns = state.cpu_ns / iterations;
+        }
+    }
+    return best;
+}
+
+static void synthesize_stream()
+{
+    // a smooth three-axis rotation at the ODR with some sensor noise
+    srand(1);
+    for (int i = 0; i < SYNTHETIC_SAMPLES; ++i)
+    {
+        double t = (double)i / Gyro::ODR_HZ;
+        double noise = (rand() % 80) - 40;
+        stream.push_back({(int16_t)(9000 * sin(2 * M_PI * 0.7 * t) + noise),
+                          (int16_t)(5000 * sin(2 * M_PI * 1.3 * t + 1.0) + noise),
+                          (int16_t)(2500 * cos(2 * M_PI * 0.7 * t) + noise)});
+    }
+}
+
+static bool load_trace(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned t;
+        int x, y, z;
+        if (line[0] != '#' && sscanf(line, "%u,%d,%d,%d", &t, &x, &y, &z) == 4)
+        {
+            stream.push_back({(int16_t)x, (int16_t)y, (int16_t)z});
+        }
+    }
+
+    fclose(file);
+    return !stream.empty();
+}
+
+static bool write_json(const char *path, const std::vector<Result> &results, const char *input)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    fprintf(file, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": \"kernel_bench\",\n", date);
+    fprintf(file, "    \"input\": \"%s\",\n    \"library_build_type\": \"release\"\n  },\n", input);
+    fprintf(file, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        fprintf(file,
+                "    {\n      \"name\": \"%s\",\n      \"run_type\": \"iteration\",\n      \"iterations\": %ld,\n"
+                "      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\",\n"
+                "      \"items_per_second\": %.1f\n    }%s\n",
+                r.name.c_str(), r.iterations, r.real_ns, r.cpu_ns, r.items * 1e9 / r.real_ns,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    return fclose(file) == 0;
+}
+
+// Reads name and real_time of every benchmark back. Not a JSON parser: it
+// relies on each name preceding its real_time, as both this tool and Google
+// Benchmark write them.
+static bool read_baseline(const char *path, std::vector<Result> &baseline)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string text;
+    char chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    {
+        text.append(chunk, got);
+    }
+    fclose(file);
+
+    size_t pos = 0;
+    for (;;)
+    {
+        size_t name = text.find("\"name\": \"", pos);
+        if (name == std::string::npos)
+        {
+            break;
+        }
+        name += strlen("\"name\": \"");
+        size_t name_end = text.find('"', name);
+        size_t time = text.find("\"real_time\": ", name_end);
+        if (name_end == std::string::npos || time == std::string::npos)
+        {
+            break;
+        }
+        Result r = {text.substr(name, name_end - name), 0, atof(text.c_str() + time + strlen("\"real_time\": ")),
+                    0.0, 0};
+        baseline.push_back(r);
+        pos = time;
+    }
+    return !baseline.empty();
+}
+
+// prints every change against the baseline; the number of regressions
+static int compare(const std::vector<Result> &results, const std::vector<Result> &baseline, double tolerance)
+{
+    int regressions = 0;
+    fprintf(stderr, "\n%-32s %12s %12s %8s\n", "against baseline", "baseline ns", "now ns", "change");
+    for (const Result &r : results)
+    {
+        const Result *before = nullptr;
+        for (const Result &b : baseline)
+        {
+            if (b.name == r.name)
+            {
+                before = &b;
+            }
+        }
+        if (!before)
+        {
+            fprintf(stderr, "%-32s %12s %12.1f %8s\n", r.name.c_str(), "-", r.real_ns, "new");
+            continue;
+        }
+
+        double change = r.real_ns / before->real_ns - 1.0;
+        bool regressed = change > tolerance;
+        regressions += regressed;
+        fprintf(stderr, "%-32s %12.1f %12.1f %+7.1f%%%s\n", r.name.c_str(), before->real_ns, r.real_ns,
+                change * 100.0, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char **argv)
+{
+    const char *trace = nullptr;
+    const char *filter = nullptr;
+    const char *out_path = nullptr;
+    const char *baseline_path = nullptr;
+    double min_time = 0.05;
+    int repetitions = 3;
+    double tolerance = 0.2;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace = argv[++i];
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            min_time = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc)
+        {
+            repetitions = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            out_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+        {
+            baseline_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "unknown argument %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (min_time <= 0.0 || repetitions < 1 || tolerance < 0.0)
+    {
+        fprintf(stderr, "--min-time and --repetitions must be positive, --tolerance not negative\n");
+        return 1;
+    }
+
+    if (trace)
+    {
+        if (!load_trace(trace))
+        {
+            fprintf(stderr, "could not read trace %s\n", trace);
+            return 1;
+        }
+    }
+    else
+    {
+        synthesize_stream();
+    }
+
+    // read first, so a bad path fails before minutes of measuring
+    std::vector<Result> baseline;
+    if (baseline_path && !read_baseline(baseline_path, baseline))
+    {
+        fprintf(stderr, "could not read baseline %s\n", baseline_path);
+        return 1;
+    }
+
+    // the matchers log their intermediate values to telemetry; nothing drains
+    // it here, so once the ring is full each log costs an encode and a drop
+    fprintf(stderr, "%zu input samples from %s\n", stream.size(), trace ? trace : "synthetic rotation");
+    fprintf(stderr, "%-32s %12s %12s %12s %10s\n", "benchmark", "time ns", "cpu ns", "iterations", "ns/sample");
+
+    std::vector<Result> results;
+    for (const Benchmark &benchmark : BENCHMARKS)
+    {
+        for (long n : SAMPLE_COUNTS)
+        {
+            std::string name = std::string(benchmark.name) + "/" + std::to_string(n);
+            if (filter && name.find(filter) == std::string::npos)
+            {
+                continue;
+            }
+            Result r = measure(benchmark, n, min_time, repetitions);
+            fprintf(stderr, "%-32s %12.1f %12.1f %12ld %10.2f\n", r.name.c_str(), r.real_ns, r.cpu_ns,
+                    r.iterations, r.real_ns / r.items);
+            results.push_back(r);
+        }
+    }
+
+    if (out_path && !write_json(out_path, results, trace ? trace : "synthetic"))
+    {
+        fprintf(stderr, "could not write %s\n", out_path);
+        return 1;
+    }
+
+    if (baseline_path)
+    {
+        int regressions = compare(results, baseline, tolerance);
+        if (regressions > 0)
+        {
+            fprintf(stderr, "\n%d benchmark%s slower than the baseline by more than %.0f%%\n", regressions,
+                    regressions == 1 ? "" : "s", tolerance * 100.0);
+            return 1;
+        }
+    }
+
+    return 0;
+}
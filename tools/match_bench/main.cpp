@@ -0,0 +1,224 @@
+// Host benchmark: cycles per match for calculate_similarity() and the DTW
+// matcher on synthetic gestures, plus how far the Q15 kernels stray from
+// their float references, and 1:N identification time against exhaustive
+// search for growing template counts with every matching policy. Build and run with
+//   pio run -e match_bench && .pio/build/match_bench/program
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "dtw.hpp"
+#include "matcher.hpp"
+#include "template_index.hpp"
+
+static const int ITERATIONS = 20000;
+static const int EQUIVALENCE_PAIRS = 2000;
+static const int IDENTIFY_PROBES = 200;
+static const int INDEX_SIZES[] = {8, 32, 128, 512};
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+static q15_t clamp_q15(double value)
+{
+    double scaled = value * 32768.0;
+    if (scaled > 32767.0)
+    {
+        return 32767;
+    }
+    if (scaled < -32768.0)
+    {
+        return -32768;
+    }
+    return (q15_t)lrint(scaled);
+}
+
+// smooth three-axis wrist rotation, `speed` stretches it in time
+static void make_gesture(Gesture &out, double speed, double phase, double amplitude, unsigned seed)
+{
+    srand(seed);
+    for (int i = 0; i < SAMPLES; ++i)
+    {
+        double t = i * speed / SAMPLES;
+        double noise = ((rand() % 1000) - 500) / 50000.0;
+        out.axis[0][i] = clamp_q15(amplitude * 0.35 * sin(2 * M_PI * t + phase) + noise);
+        out.axis[1][i] = clamp_q15(amplitude * 0.20 * sin(4 * M_PI * t + phase) + noise);
+        out.axis[2][i] = clamp_q15(amplitude * 0.10 * cos(2 * M_PI * t + phase) + noise);
+    }
+}
+
+typedef int32_t (*Matcher)(const Gesture &, const Gesture &);
+
+static void run(const char *name, Matcher match, const Gesture &a, const Gesture &b)
+{
+    int32_t score = 0;
+    uint64_t start = cycles();
+    auto wall = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        score = match(a, b);
+    }
+    uint64_t elapsed = cycles() - start;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - wall).count();
+
+    fprintf(stderr, "%-28s %10.0f cycles/match %9.1f ns/match  score %.4f\n",
+            name, (double)elapsed / ITERATIONS, ns / ITERATIONS, score / 32768.0);
+}
+
+static int32_t dtw_kernel(const Gesture &a, const Gesture &b)
+{
+    return (int32_t)(dtw_distance(a, b, DTW_BAND, DTW_INFINITY) >> 7);
+}
+
+static int32_t reference_kernel(const Gesture &a, const Gesture &b)
+{
+    return to_q15(reference_similarity(a, b));
+}
+
+static void check_equivalence()
+{
+    static Gesture a, b;
+    double worst_similarity = 0.0;
+    double worst_dtw = 0.0;
+
+    for (int n = 0; n < EQUIVALENCE_PAIRS; ++n)
+    {
+        make_gesture(a, 0.8 + (n % 7) * 0.1, 0.0, 0.5 + (n % 5) * 0.5, 2 * n + 1);
+        make_gesture(b, 0.8 + (n % 3) * 0.2, (n % 4) * M_PI / 2, 0.5 + (n % 6) * 0.4, 2 * n + 2);
+
+        double similarity_error = fabs(calculate_similarity(a, b) / 32768.0 - reference_similarity(a, b));
+        double dtw_fixed = dtw_distance(a, b, DTW_BAND, DTW_INFINITY) / (double)(1 << 22);
+        double dtw_float = reference_dtw_distance(a, b, DTW_BAND);
+        double dtw_error = fabs(dtw_fixed - dtw_float) / (dtw_float > 1e-3 ? dtw_float : 1e-3);
+
+        worst_similarity = similarity_error > worst_similarity ? similarity_error : worst_similarity;
+        worst_dtw = dtw_error > worst_dtw ? dtw_error : worst_dtw;
+    }
+
+    fprintf(stderr, "Q15 vs float over %d pairs: similarity max abs error %.6f, dtw max rel error %.6f\n",
+            EQUIVALENCE_PAIRS, worst_similarity, worst_dtw);
+}
+
+// exhaustive 1:N search with the same rules as TemplateIndex::identify()
+template <class Matcher>
+static int identify_exhaustive(const std::vector<Gesture> &templates,
+                               const std::vector<typename Matcher::Features> &features, const Gesture &probe)
+{
+    typename Matcher::Features probe_features;
+    Matcher::features(probe, probe_features);
+
+    int best = TemplateIndex<Matcher>::NO_MATCH;
+    uint32_t best_cost = Matcher::ACCEPT_COST;
+    for (size_t t = 0; t < templates.size(); ++t)
+    {
+        uint32_t cost = Matcher::cost(probe, probe_features, templates[t], features[t], UINT32_MAX);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best = (int)t;
+        }
+    }
+    return best != TemplateIndex<Matcher>::NO_MATCH && Matcher::similarity(best_cost) > ACCEPT_THRESHOLD
+               ? best
+               : TemplateIndex<Matcher>::NO_MATCH;
+}
+
+static void make_user_gesture(Gesture &out, int user, double speed, unsigned seed)
+{
+    make_gesture(out, (0.7 + (user % 11) * 0.06) * speed, (user % 13) * M_PI / 6.5, 0.4 + (user % 7) * 0.1, seed);
+}
+
+template <class Matcher>
+static void bench_identify()
+{
+    fprintf(stderr, "\n1:N identification with the %s matcher, %d probes, half genuine\n", Matcher::name(),
+            IDENTIFY_PROBES);
+    for (int n : INDEX_SIZES)
+    {
+        std::vector<Gesture> templates(n);
+        std::vector<typename Matcher::Features> features(n);
+        std::vector<typename TemplateIndex<Matcher>::Entry> storage(n);
+        TemplateIndex<Matcher> index(storage.data(), n);
+        for (int t = 0; t < n; ++t)
+        {
+            make_user_gesture(templates[t], t, 1.0, 1000 + t);
+            Matcher::features(templates[t], features[t]);
+            index.add(t, templates[t]);
+        }
+
+        std::vector<Gesture> probes(IDENTIFY_PROBES);
+        for (int p = 0; p < IDENTIFY_PROBES; ++p)
+        {
+            // genuine probes repeat a user a little faster, impostors are users never enrolled
+            int user = p % 2 ? (p * 7919) % n : n + p;
+            make_user_gesture(probes[p], user, p % 2 ? 1.1 : 1.0, 5000 + p);
+        }
+
+        uint64_t indexed_cycles = 0, exhaustive_cycles = 0;
+        long bounded = 0, evaluated = 0;
+        int mismatches = 0, identified = 0;
+        for (const Gesture &probe : probes)
+        {
+            uint64_t start = cycles();
+            typename TemplateIndex<Matcher>::Match match = index.identify(probe);
+            uint64_t middle = cycles();
+            int reference = identify_exhaustive<Matcher>(templates, features, probe);
+            exhaustive_cycles += cycles() - middle;
+            indexed_cycles += middle - start;
+
+            bounded += match.bounded;
+            evaluated += match.evaluated;
+            identified += match.id != TemplateIndex<Matcher>::NO_MATCH;
+            mismatches += match.id != reference;
+        }
+
+        fprintf(stderr, "%4d templates: indexed %9.0f cycles, exhaustive %10.0f cycles, "
+                        "%6.1f bounded, %5.2f fully compared, %d identified, %d disagree\n",
+                n, (double)indexed_cycles / IDENTIFY_PROBES, (double)exhaustive_cycles / IDENTIFY_PROBES,
+                (double)bounded / IDENTIFY_PROBES, (double)evaluated / IDENTIFY_PROBES, identified, mismatches);
+    }
+}
+
+int main()
+{
+    // the matchers log their intermediate values to telemetry; nothing drains
+    // it here, so once the ring is full each log costs an encode and a drop
+    static Gesture enrolled, genuine_fast, impostor;
+
+    make_gesture(enrolled, 1.0, 0.0, 1.0, 1);
+    make_gesture(genuine_fast, 1.15, 0.0, 1.0, 2);
+    make_gesture(impostor, 1.0, M_PI, 1.0, 3);
+
+    fprintf(stderr, "template footprint: %u bytes\n", (unsigned)sizeof(Gesture));
+
+    run("float reference genuine", reference_kernel, enrolled, genuine_fast);
+    run("similarity genuine", calculate_similarity, enrolled, genuine_fast);
+    run("similarity impostor", calculate_similarity, enrolled, impostor);
+    run("dtw genuine", dtw_similarity, enrolled, genuine_fast);
+    run("dtw impostor (abandons)", dtw_similarity, enrolled, impostor);
+    run("dtw kernel, no abandon", dtw_kernel, enrolled, impostor);
+
+    check_equivalence();
+    bench_identify<DtwMatcher>();
+    bench_identify<WeightedMatcher>();
+    bench_identify<CorrelationMatcher>();
+    bench_identify<SpectralMatcher>();
+
+    return 0;
+}
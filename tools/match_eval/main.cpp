@@ -0,0 +1,641 @@
+// Offline FAR/FRR evaluation: turns a corpus of recorded gesture traces into
+// gestures through the real filter bank, segmenter and resampler, scores every
+// pair with the real matchers on all cores, and sweeps the accept threshold
+// and the calculate_similarity() weights. Build and run with
+//   pio run -e match_eval && .pio/build/match_eval/program [manifest.txt]
+//       [--threads N] [--step 0.1] [--curve curve.csv] [--max-far 0.01] [--max-frr 0.1]
+//
+// The manifest lists one trace per line as `subject path`, paths relative to
+// the manifest, '#' starting a comment. Traces use the simulation's CSV format
+// (time_ms,x_raw,y_raw,z_raw[,touch_x,touch_y], bias corrected, at the ODR),
+// one gesture each; tools/telemetry_decode --csv produces them. Pairs from
+// the same subject are genuine, all others impostors. Without a manifest a
+// synthetic corpus of 40 subjects with 20 attempts each is generated.
+//
+// A pair is accepted when its score is above the threshold, as on the board.
+// FAR is the share of accepted impostor pairs and FRR the share of rejected
+// genuine ones. --curve writes both for every threshold in steps of 0.01 for
+// the deployed weights, the best weights found and DTW.
+//
+// Every matching policy of match_policy.hpp then runs on the same gestures:
+// its FAR and FRR, the time of one full comparison, and whether its bound
+// ever exceeded its cost, which would make TemplateIndex miss matches. The
+// fastest policy within --max-far and --max-frr at the accept threshold is
+// recommended, and a bound violation fails the run.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dtw.hpp"
+#include "filter_bank.hpp"
+#include "match_policy.hpp"
+#include "matcher.hpp"
+#include "segmenter.hpp"
+
+static const int SYNTHETIC_SUBJECTS = 40;
+static const int SYNTHETIC_ATTEMPTS = 20;
+static const int TOP_WEIGHTS = 10;
+
+struct Sample
+{
+    int16_t x, y, z;
+};
+
+struct Entry
+{
+    int subject;
+    Gesture gesture;
+};
+
+struct PairScore
+{
+    SimilarityTerms terms;
+    int32_t dtw; // Q15, without early abandoning
+    bool genuine;
+};
+
+struct Rates
+{
+    double eer;
+    int32_t eer_threshold; // Q15
+    double far, frr;       // at ACCEPT_THRESHOLD
+};
+
+struct WeightResult
+{
+    SimilarityWeights weights;
+    Rates rates;
+};
+
+struct PolicyResult
+{
+    const char *name;
+    Rates rates;
+    double compare_ns;     // one full comparison, abandoning at ACCEPT_COST
+    uint64_t violations;   // pairs whose bound exceeded their cost
+};
+
+static const size_t TIMED_PAIRS = 20000;
+
+// Runs fn(i) for every i below count on `threads` workers. Work is handed out
+// in small chunks through an atomic cursor so uneven items still balance.
+template <typename F>
+static void parallel_for(size_t count, unsigned threads, F fn)
+{
+    const size_t CHUNK = 64;
+    std::atomic<size_t> cursor{0};
+    auto worker = [&]() {
+        for (size_t begin; (begin = cursor.fetch_add(CHUNK)) < count;)
+        {
+            size_t end = std::min(begin + CHUNK, count);
+            for (size_t i = begin; i < end; ++i)
+            {
+                fn(i);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+}
+
+static bool load_trace(const std::string &path, std::vector<Sample> &samples)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned t;
+        int x, y, z;
+        if (line[0] != '#' && sscanf(line, "%u,%d,%d,%d", &t, &x, &y, &z) == 4)
+        {
+            samples.push_back({(int16_t)x, (int16_t)y, (int16_t)z});
+        }
+    }
+
+    fclose(file);
+    return !samples.empty();
+}
+
+// the capture path of App: filter, decimate, segment, resample
+static bool extract(const std::vector<Sample> &samples, Gesture &out)
+{
+    FilterBank filters;
+    static thread_local Segmenter segmenter;
+    segmenter.reset();
+
+    // trailing stillness closes a gesture that runs to the end of the trace
+    size_t total = samples.size() + Gyro::ODR_HZ;
+    GyroData block[FilterBank::BLOCK];
+    GyroData filtered[FilterBank::BLOCK];
+    for (size_t begin = 0; begin < total; begin += FilterBank::BLOCK)
+    {
+        size_t count = std::min(total - begin, FilterBank::BLOCK);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Sample s = begin + i < samples.size() ? samples[begin + i] : Sample{0, 0, 0};
+            block[i] = {0.0f, 0.0f, 0.0f, s.x, s.y, s.z};
+        }
+
+        size_t produced = filters.process(block, count, filtered);
+        for (size_t i = 0; i < produced; ++i)
+        {
+            Segmenter::Event event = segmenter.add(filtered[i]);
+            if (event == Segmenter::FINISHED)
+            {
+                segmenter.resample(out);
+                return true;
+            }
+            if (event == Segmenter::TIMED_OUT)
+            {
+                return false;
+            }
+        }
+    }
+    return false;
+}
+
+static bool load_manifest(const char *path, std::vector<std::string> &paths, std::vector<int> &subjects)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string dir(path);
+    size_t slash = dir.find_last_of('/');
+    dir = slash == std::string::npos ? "" : dir.substr(0, slash + 1);
+
+    std::vector<std::string> names;
+    char line[512];
+    while (fgets(line, sizeof(line), file))
+    {
+        char subject[128], trace[384];
+        if (line[0] == '#' || sscanf(line, "%127s %383s", subject, trace) != 2)
+        {
+            continue;
+        }
+        auto known = std::find(names.begin(), names.end(), subject);
+        subjects.push_back((int)(known - names.begin()));
+        if (known == names.end())
+        {
+            names.push_back(subject);
+        }
+        paths.push_back(trace[0] == '/' ? std::string(trace) : dir + trace);
+    }
+
+    fclose(file);
+    return !paths.empty();
+}
+
+// Every subject has their own three-axis motion; each attempt varies its
+// speed, size and timing and adds sensor noise.
+static void synthesize(int subject, int attempt, std::vector<Sample> &samples)
+{
+    std::mt19937 shape_rng(1000 + subject);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    double amplitude[3], harmonic[3], phase[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        amplitude[k] = 2500 + 7500 * unit(shape_rng);
+        harmonic[k] = 1 + (int)(3 * unit(shape_rng));
+        phase[k] = 2 * M_PI * unit(shape_rng);
+    }
+    double duration_s = 1.5 + 1.5 * unit(shape_rng);
+
+    std::mt19937 rng(subject * 7919 + attempt);
+    std::normal_distribution<double> jitter(0.0, 1.0);
+    double speed = 1.0 + 0.07 * jitter(rng);
+    double scale = 1.0 + 0.08 * jitter(rng);
+    double skew = 0.15 * jitter(rng);
+    std::normal_distribution<double> noise(0.0, 40.0);
+
+    const int rate = Gyro::ODR_HZ;
+    int lead = rate / 2 + (int)(rate / 4 * unit(rng));
+    int length = (int)(duration_s / speed * rate);
+    for (int i = 0; i < lead; ++i)
+    {
+        samples.push_back({(int16_t)noise(rng), (int16_t)noise(rng), (int16_t)noise(rng)});
+    }
+    for (int i = 0; i < length; ++i)
+    {
+        double t = (double)i / length;
+        int16_t xyz[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            // a full period of sin over the gesture, with an envelope so it starts and ends at rest
+            double envelope = sin(M_PI * t);
+            double value = scale * amplitude[k] * envelope * sin(2 * M_PI * harmonic[k] * t + phase[k] + skew * t);
+            xyz[k] = (int16_t)(value + noise(rng));
+        }
+        samples.push_back({xyz[0], xyz[1], xyz[2]});
+    }
+}
+
+// Genuine and impostor scores binned at full Q15 resolution, so FAR and FRR
+// are exact at every threshold.
+class ScoreHistogram
+{
+public:
+    void clear()
+    {
+        std::fill(genuine.begin(), genuine.end(), 0);
+        std::fill(impostor.begin(), impostor.end(), 0);
+        genuine_total = impostor_total = 0;
+    }
+
+    void add(int32_t score, bool is_genuine)
+    {
+        score = std::max(0, std::min(score, Q15_ONE));
+        if (is_genuine)
+        {
+            genuine[score]++;
+            genuine_total++;
+        }
+        else
+        {
+            impostor[score]++;
+            impostor_total++;
+        }
+    }
+
+    // cumulative FAR/FRR for every threshold from 0 to Q15_ONE
+    void curves(std::vector<double> &far, std::vector<double> &frr) const
+    {
+        far.assign(Q15_ONE + 1, 0.0);
+        frr.assign(Q15_ONE + 1, 0.0);
+        uint64_t rejected_genuine = 0, accepted_impostor = impostor_total;
+        for (int t = 0; t <= Q15_ONE; ++t)
+        {
+            rejected_genuine += genuine[t];
+            accepted_impostor -= impostor[t];
+            frr[t] = genuine_total ? (double)rejected_genuine / genuine_total : 0.0;
+            far[t] = impostor_total ? (double)accepted_impostor / impostor_total : 0.0;
+        }
+    }
+
+    Rates rates() const
+    {
+        std::vector<double> far, frr;
+        curves(far, frr);
+
+        Rates result = {1.0, 0, far[ACCEPT_THRESHOLD], frr[ACCEPT_THRESHOLD]};
+        double best_gap = 2.0;
+        for (int t = 0; t <= Q15_ONE; ++t)
+        {
+            double gap = fabs(far[t] - frr[t]);
+            if (gap < best_gap)
+            {
+                best_gap = gap;
+                result.eer = (far[t] + frr[t]) / 2;
+                result.eer_threshold = t;
+            }
+        }
+        return result;
+    }
+
+private:
+    std::vector<uint64_t> genuine = std::vector<uint64_t>(Q15_ONE + 1);
+    std::vector<uint64_t> impostor = std::vector<uint64_t>(Q15_ONE + 1);
+    uint64_t genuine_total = 0;
+    uint64_t impostor_total = 0;
+};
+
+static void fill_weighted(ScoreHistogram &histogram, const std::vector<PairScore> &pairs,
+                          const SimilarityWeights &weights)
+{
+    histogram.clear();
+    for (const PairScore &pair : pairs)
+    {
+        histogram.add(weigh_similarity(pair.terms, weights), pair.genuine);
+    }
+}
+
+static void print_rates(const char *name, const Rates &rates)
+{
+    printf("%-34s EER %6.2f%% at %.4f   at %.2f: FAR %6.2f%%  FRR %6.2f%%\n", name, 100 * rates.eer,
+           rates.eer_threshold / (double)Q15_ONE, ACCEPT_THRESHOLD / (double)Q15_ONE, 100 * rates.far,
+           100 * rates.frr);
+}
+
+static void weights_name(char *out, size_t size, const SimilarityWeights &w)
+{
+    snprintf(out, size, "weights %.2f/%.2f/%.2f", w.mse / (double)Q15_ONE, w.energy / (double)Q15_ONE,
+             w.sign / (double)Q15_ONE);
+}
+
+static bool write_curves(const char *path, const ScoreHistogram *histograms[3])
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::vector<double> far[3], frr[3];
+    for (int m = 0; m < 3; ++m)
+    {
+        histograms[m]->curves(far[m], frr[m]);
+    }
+
+    fprintf(file, "threshold,far_deployed,frr_deployed,far_best,frr_best,far_dtw,frr_dtw\n");
+    for (int step = 0; step <= 100; ++step)
+    {
+        int t = std::min(step * Q15_ONE / 100, Q15_ONE);
+        fprintf(file, "%.2f", step / 100.0);
+        for (int m = 0; m < 3; ++m)
+        {
+            fprintf(file, ",%.6f,%.6f", far[m][t], frr[m][t]);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+    return true;
+}
+
+// Scores every pair of the corpus with Matcher, from features computed once
+// per gesture as TemplateIndex keeps them, and times a single-threaded pass.
+template <class Matcher>
+static PolicyResult evaluate_policy(const std::vector<Entry> &corpus, unsigned threads)
+{
+    size_t n = corpus.size();
+    std::vector<typename Matcher::Features> features(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        Matcher::features(corpus[i].gesture, features[i]);
+    }
+
+    std::vector<int32_t> scores(n * (n - 1) / 2);
+    std::atomic<uint64_t> violations{0};
+    parallel_for(n, threads, [&](size_t i) {
+        size_t base = i * (2 * n - i - 1) / 2;
+        for (size_t j = i + 1; j < n; ++j)
+        {
+            const Gesture &a = corpus[i].gesture, &b = corpus[j].gesture;
+            uint32_t cost = Matcher::cost(a, features[i], b, features[j], UINT32_MAX);
+            if (Matcher::bound(a, features[i], b, features[j], UINT32_MAX) > cost)
+            {
+                violations++;
+            }
+            scores[base + j - i - 1] = Matcher::similarity(cost);
+        }
+    });
+
+    ScoreHistogram histogram;
+    for (size_t i = 0, p = 0; i < n; ++i)
+    {
+        for (size_t j = i + 1; j < n; ++j, ++p)
+        {
+            histogram.add(scores[p], corpus[i].subject == corpus[j].subject);
+        }
+    }
+
+    // the same pairs for every policy, as the device would compare them
+    size_t timed = 0;
+    uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n && timed < TIMED_PAIRS; ++i)
+    {
+        for (size_t j = i + 1; j < n && timed < TIMED_PAIRS; ++j, ++timed)
+        {
+            sink += Matcher::cost(corpus[i].gesture, features[i], corpus[j].gesture, features[j], Matcher::ACCEPT_COST);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    asm volatile("" : : "g"(sink));
+
+    return {Matcher::name(), histogram.rates(), ns / timed, violations.load()};
+}
+
+int main(int argc, char **argv)
+{
+    const char *manifest = nullptr;
+    const char *curve_path = nullptr;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    double step = 0.1;
+    double max_far = 0.01;
+    double max_frr = 0.1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            threads = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc)
+        {
+            step = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--curve") == 0 && i + 1 < argc)
+        {
+            curve_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--max-far") == 0 && i + 1 < argc)
+        {
+            max_far = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-frr") == 0 && i + 1 < argc)
+        {
+            max_frr = atof(argv[++i]);
+        }
+        else
+        {
+            manifest = argv[i];
+        }
+    }
+    if (step <= 0.0 || step > 1.0)
+    {
+        fprintf(stderr, "--step must be in (0, 1]\n");
+        return 1;
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+    };
+
+    // ----- Corpus -----
+    std::vector<std::string> paths;
+    std::vector<int> subjects;
+    if (manifest)
+    {
+        if (!load_manifest(manifest, paths, subjects))
+        {
+            fprintf(stderr, "could not read manifest %s\n", manifest);
+            return 1;
+        }
+    }
+    else
+    {
+        for (int s = 0; s < SYNTHETIC_SUBJECTS; ++s)
+        {
+            for (int a = 0; a < SYNTHETIC_ATTEMPTS; ++a)
+            {
+                subjects.push_back(s);
+            }
+        }
+    }
+
+    std::vector<Entry> entries(subjects.size());
+    std::vector<char> usable(subjects.size(), 0);
+    parallel_for(subjects.size(), threads, [&](size_t i) {
+        std::vector<Sample> samples;
+        bool loaded = manifest ? load_trace(paths[i], samples)
+                               : (synthesize(subjects[i], (int)i % SYNTHETIC_ATTEMPTS, samples), true);
+        entries[i].subject = subjects[i];
+        usable[i] = loaded && extract(samples, entries[i].gesture);
+    });
+
+    std::vector<Entry> corpus;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (usable[i])
+        {
+            corpus.push_back(entries[i]);
+        }
+        else
+        {
+            fprintf(stderr, "no gesture in %s\n", manifest ? paths[i].c_str() : "synthetic attempt");
+        }
+    }
+    if (corpus.size() < 2)
+    {
+        fprintf(stderr, "need at least two gestures\n");
+        return 1;
+    }
+    double extract_ms = elapsed_ms();
+
+    // ----- Pair scores, the expensive part, computed once -----
+    size_t n = corpus.size();
+    std::vector<PairScore> pairs(n * (n - 1) / 2);
+    parallel_for(n, threads, [&](size_t i) {
+        // row i holds pairs (i, j > i), stored after the rows before it
+        size_t base = i * (2 * n - i - 1) / 2;
+        for (size_t j = i + 1; j < n; ++j)
+        {
+            PairScore &pair = pairs[base + j - i - 1];
+            pair.terms = similarity_terms(corpus[i].gesture, corpus[j].gesture);
+            pair.dtw = dtw_cost_similarity(dtw_distance(corpus[i].gesture, corpus[j].gesture, DTW_BAND, DTW_INFINITY));
+            pair.genuine = corpus[i].subject == corpus[j].subject;
+        }
+    });
+    double score_ms = elapsed_ms();
+
+    size_t genuine = std::count_if(pairs.begin(), pairs.end(), [](const PairScore &p) { return p.genuine; });
+    printf("corpus: %u gestures, %u genuine pairs, %u impostor pairs, %u threads\n", (unsigned)n,
+           (unsigned)genuine, (unsigned)(pairs.size() - genuine), threads);
+
+    // ----- Weight sweep -----
+    std::vector<SimilarityWeights> grid;
+    int steps = (int)lround(1.0 / step);
+    for (int m = 0; m <= steps; ++m)
+    {
+        for (int e = 0; m + e <= steps; ++e)
+        {
+            int32_t mse = to_q15((double)m / steps);
+            int32_t energy = to_q15((double)e / steps);
+            grid.push_back({mse, energy, Q15_ONE - mse - energy});
+        }
+    }
+
+    std::vector<WeightResult> results(grid.size());
+    parallel_for(grid.size(), threads, [&](size_t i) {
+        static thread_local ScoreHistogram histogram;
+        fill_weighted(histogram, pairs, grid[i]);
+        results[i] = {grid[i], histogram.rates()};
+    });
+    std::sort(results.begin(), results.end(),
+              [](const WeightResult &a, const WeightResult &b) { return a.rates.eer < b.rates.eer; });
+    double sweep_ms = elapsed_ms();
+
+    ScoreHistogram deployed, best, dtw;
+    fill_weighted(deployed, pairs, SIMILARITY_WEIGHTS);
+    fill_weighted(best, pairs, results[0].weights);
+    for (const PairScore &pair : pairs)
+    {
+        dtw.add(pair.dtw, pair.genuine);
+    }
+
+    char name[64];
+    weights_name(name, sizeof(name), SIMILARITY_WEIGHTS);
+    printf("\ndeployed matcher\n");
+    print_rates(name, deployed.rates());
+    print_rates("dtw", dtw.rates());
+
+    printf("\nbest of %u weightings (mse/energy/sign)\n", (unsigned)grid.size());
+    for (int i = 0; i < TOP_WEIGHTS && i < (int)results.size(); ++i)
+    {
+        weights_name(name, sizeof(name), results[i].weights);
+        print_rates(name, results[i].rates);
+    }
+
+    if (curve_path)
+    {
+        const ScoreHistogram *curves[3] = {&deployed, &best, &dtw};
+        if (!write_curves(curve_path, curves))
+        {
+            fprintf(stderr, "could not create %s\n", curve_path);
+            return 1;
+        }
+    }
+
+    // ----- Matching policies on the same gestures -----
+    double policies_start = elapsed_ms();
+    const PolicyResult policies[] = {
+        evaluate_policy<WeightedMatcher>(corpus, threads),
+        evaluate_policy<DtwMatcher>(corpus, threads),
+        evaluate_policy<CorrelationMatcher>(corpus, threads),
+        evaluate_policy<SpectralMatcher>(corpus, threads),
+    };
+
+    printf("\nmatching policies, target FAR <= %.2f%% and FRR <= %.2f%%\n", 100 * max_far, 100 * max_frr);
+    const PolicyResult *fastest = nullptr;
+    bool conforming = true;
+    for (const PolicyResult &policy : policies)
+    {
+        print_rates(policy.name, policy.rates);
+        bool on_target = policy.rates.far <= max_far && policy.rates.frr <= max_frr;
+        printf("%-34s %8.1f ns per comparison, %llu bound violations%s\n", "", policy.compare_ns,
+               (unsigned long long)policy.violations, on_target ? ", on target" : "");
+        if (on_target && (!fastest || policy.compare_ns < fastest->compare_ns))
+        {
+            fastest = &policy;
+        }
+        conforming &= policy.violations == 0;
+    }
+    printf("fastest on target: %s\n", fastest ? fastest->name : "none");
+
+    printf("\ntime: extract %.0f ms, score %.0f ms, sweep %.0f ms, policies %.0f ms, total %.0f ms\n", extract_ms,
+           score_ms - extract_ms, sweep_ms - score_ms, elapsed_ms() - policies_start, elapsed_ms());
+    if (!conforming)
+    {
+        fprintf(stderr, "a policy's bound exceeded its cost\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Host decoder for the binary telemetry channel: prints events as text and
+// optionally exports the raw sample stream as a trace the host simulation can
+// replay. Build and run with
+//   pio run -e telemetry_decode
+//   .pio/build/telemetry_decode/program [capture.bin | -] [--csv trace.csv] [--odr hz] [--quiet]
+// Reads stdin without a capture file, so a serial port can be piped in
+// directly (configure it raw at 115200 baud first).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "host_telemetry.hpp"
+
+struct Export
+{
+    FILE *csv;
+    uint32_t odr_hz;
+};
+
+// same columns as a host_main trace, with the touch columns left idle
+static void write_sample(const TelemetryDecoder::Sample &sample, void *context)
+{
+    Export &out = *(Export *)context;
+    unsigned long time_ms = (unsigned long)((uint64_t)sample.sequence * 1000 / out.odr_hz);
+    fprintf(out.csv, "%lu,%d,%d,%d,0,0\n", time_ms, sample.x, sample.y, sample.z);
+}
+
+int main(int argc, char **argv)
+{
+    const char *input_path = nullptr;
+    const char *csv_path = nullptr;
+    Export out = {nullptr, 200};
+    bool quiet = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csv_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--odr") == 0 && i + 1 < argc)
+        {
+            out.odr_hz = (uint32_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--quiet") == 0)
+        {
+            quiet = true;
+        }
+        else
+        {
+            input_path = argv[i];
+        }
+    }
+
+    if (out.odr_hz == 0)
+    {
+        fprintf(stderr, "bad --odr\n");
+        return 1;
+    }
+
+    FILE *input = stdin;
+    if (input_path && strcmp(input_path, "-") != 0 && !(input = fopen(input_path, "rb")))
+    {
+        fprintf(stderr, "could not open %s\n", input_path);
+        return 1;
+    }
+
+    TelemetryDecoder decoder;
+    decoder.timestamps = true;
+    decoder.text = quiet ? nullptr : stdout;
+
+    if (csv_path)
+    {
+        if (!(out.csv = fopen(csv_path, "w")))
+        {
+            fprintf(stderr, "could not create %s\n", csv_path);
+            return 1;
+        }
+        fprintf(out.csv, "# time_ms,x_raw,y_raw,z_raw,touch_x,touch_y\n");
+        decoder.on_sample = write_sample;
+        decoder.context = &out;
+    }
+
+    uint8_t buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), input)) > 0)
+    {
+        decoder.feed(buf, len);
+        fflush(stdout);
+    }
+
+    if (out.csv)
+    {
+        fclose(out.csv);
+    }
+
+    fprintf(stderr, "%lu frames, %lu bad, %lu samples, %lu samples lost on the target\n",
+            (unsigned long)decoder.counters.frames, (unsigned long)decoder.counters.bad_frames,
+            (unsigned long)decoder.counters.samples, (unsigned long)decoder.counters.lost_samples);
+    return 0;
+}